@@ -52,5 +52,5 @@ AIT_FLAGS_DESIGN_ = -fompss-fpga-ait-flags "$(AIT_FLAGS_DESIGN__)"
 AIT_FLAGS_D_      = -fompss-fpga-ait-flags "$(AIT_FLAGS_D__)"
 
 clean:
-	rm -fv *.o $(PROGRAM_)-? $(PROGRAM_)_hls_automatic_clang.cpp ait_extracted.json
+	rm -fv *.o $(PROGRAM_)-? $(PROGRAM_)-mpi lib$(PROGRAM_).so dagsim $(PROGRAM_)_hls_automatic_clang.cpp ait_extracted.json
 	rm -frv $(PROGRAM_)_ait
@@ -49,5 +49,5 @@ ifdef DISABLE_UTILIZATION_CHECK
 endif
 
 clean:
-	rm -fv *.o $(PROGRAM_)-? $(COMPILER_)_$(PROGRAM_)*.c *hls_auto_mcxx.cpp ait_$(PROGRAM_)*.json
+	rm -fv *.o $(PROGRAM_)-? $(PROGRAM_)-mpi lib$(PROGRAM_).so dagsim $(COMPILER_)_$(PROGRAM_)*.c *hls_auto_mcxx.cpp ait_$(PROGRAM_)*.json
 	rm -frv $(PROGRAM_)_ait
@@ -6,9 +6,9 @@ if [ "$BOARD" == "alveo_u200" ]; then
 	for EXEC_MODE in d p; do
 	  for MATRIX_SIZE in 5120 10240; do
 	    echo "=== Check mode: ${EXEC_MODE}, msize: ${MATRIX_SIZE} ==="
-	    ##NOTE: Check == 2 -> enables the warm-up mode
-	    CHECK=$([ "$MATRIX_SIZE" == "5120" ] && echo 1 || echo 2)
-		timeout --preserve-status 150s ./build/cholesky-${EXEC_MODE} ${MATRIX_SIZE} ${CHECK}
+	    ##NOTE: Check == 3 -> enables the randomized O(n^2) check, cheap enough for the big size
+	    CHECK=$([ "$MATRIX_SIZE" == "5120" ] && echo 1 || echo 3)
+		timeout --preserve-status 150s ./build/cholesky-${EXEC_MODE} -r 3 ${MATRIX_SIZE} ${CHECK}
 	    cat test_result.json >>$RES_FILE
 	    echo "," >>$RES_FILE
 	  done
@@ -17,9 +17,9 @@ elif [ "$BOARD" == "zcu102" ]; then
 	for EXEC_MODE in d p; do
 	  for MATRIX_SIZE in 2048 4096; do
 	    echo "=== Check mode: ${EXEC_MODE}, msize: ${MATRIX_SIZE} ==="
-	    ##NOTE: Check == 2 -> enables the warm-up mode
-	    CHECK=$([ "$MATRIX_SIZE" == "2048" ] && echo 1 || echo 2)
-		timeout --preserve-status 150s ./build/cholesky-${EXEC_MODE} ${MATRIX_SIZE} ${CHECK}
+	    ##NOTE: Check == 3 -> enables the randomized O(n^2) check, cheap enough for the big size
+	    CHECK=$([ "$MATRIX_SIZE" == "2048" ] && echo 1 || echo 3)
+		timeout --preserve-status 150s ./build/cholesky-${EXEC_MODE} -r 3 ${MATRIX_SIZE} ${CHECK}
 	    cat test_result.json >>$RES_FILE
 	    echo "," >>$RES_FILE
 	  done
@@ -34,48 +34,69 @@
 
 #include "cholesky.h"
 #include "cholesky.fpga.h"
+#include "cholesky.smp.h"
+#include "kstats.h"
+#include "tilealloc.h"
+#include "coexec.h"
+
+#if defined(COEXEC) && defined(OPENBLAS_IMPL)
+#  error COEXEC needs the FPGA kernels, it cannot be used with OPENBLAS_IMPL
+#endif
 
 const unsigned int FPGA_GEMM_II = FPGA_GEMM_LOOP_II;
 const unsigned int FPGA_OTHER_II = FPGA_OTHER_LOOP_II;
+#ifdef DYNAMIC_TS
+int ts = BLOCK_SIZE; // tile size
+#else
 const int ts = BLOCK_SIZE; // tile size
+#endif
 const unsigned int FPGA_PWIDTH = FPGA_MEMORY_PORT_WIDTH;
 const unsigned int SYRK_NUMACCS = SYRK_NUM_ACCS;
 const unsigned int GEMM_NUMACCS = GEMM_NUM_ACCS;
 const unsigned int TRSM_NUMACCS = TRSM_NUM_ACCS;
 
-static void gather_block(const int N, type_t *Alin, type_t *A)
+#define CHECK_PROBES 4 // random probe vectors of the randomized check
+#define TUNE_FILE "cholesky_ts.cfg" // tile sizes found by the tuning mode
+
+#ifdef OPENBLAS_IMPL
+//NOTE: Priority of the next tile task created by the current thread. Only SMP
+//      creators can honor it, tasks created by the FPGA keep their creation order
+__thread int task_prio;
+#  define TASK_PRIO(p) task_prio = (p)
+#  define PRIO_CLAUSE  priority(task_prio)
+#else
+#  define TASK_PRIO(p)
+#  define PRIO_CLAUSE
+#endif
+
+#pragma oss task in([ts*ts]A) out(Alin[0;ts][0;ts])
+void scatter_block(const int N, const type_t *A, type_t (*Alin)[N])
 {
    for (int i = 0; i < ts; i++) {
-      for (int j = 0; j < ts; j++) {
-         A[i*ts + j] = Alin[i*N + j];
-      }
+      memcpy(&Alin[i][0], &A[i*ts], ts*sizeof(type_t));
    }
 }
 
-static void scatter_block(const int N, type_t *A, type_t *Alin)
+void convert_to_linear(const int nt, const int N, type_t *A, type_t (*Alin)[N])
 {
-   for (int i = 0; i < ts; i++) {
-      for (int j = 0; j < ts; j++) {
-         Alin[i*N + j] = A[i*ts + j];
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         scatter_block(N, A + TILE_IDX(i, j)*ts*ts, (type_t (*)[N]) &Alin[j*ts][i*ts]);
       }
    }
 }
 
-static void convert_to_blocks(const int DIM, const int N, type_t (*Alin)[N], type_t *A[DIM][DIM])
+#pragma oss task in([ts*ts]src) out([ts*ts]dst)
+void copy_block(const type_t *src, type_t *dst)
 {
-   for (int i = 0; i < DIM; i++) {
-      for (int j = 0; j < DIM; j++) {
-         gather_block(N, &Alin[i*ts][j*ts], A[i][j]);
-      }
-   }
+   memcpy(dst, src, ts*ts*sizeof(type_t));
 }
 
-static void convert_to_linear(const int DIM, const int N, type_t *A[DIM][DIM], type_t (*Alin)[N])
+// Creates one copy task per tile, used to snapshot and restore blocked matrices
+void copy_tiles(const int ntiles, const type_t *src, type_t *dst)
 {
-   for (int i = 0; i < DIM; i++) {
-      for (int j = 0; j < DIM; j++) {
-         scatter_block(N, A[i][j], (type_t *) &Alin[i*ts][j*ts]);
-      }
+   for (int i = 0; i < ntiles; i++) {
+      copy_block(src + i*ts*ts, dst + i*ts*ts);
    }
 }
 
@@ -85,7 +106,7 @@ void flushData(const type_t *data, int len) {
 }
 
 #ifdef POTRF_SMP
-#pragma oss task inout([ts*ts]A)
+#pragma oss task inout([ts*ts]A) PRIO_CLAUSE
 #else
 #pragma oss task device(fpga) inout([ts*ts]A) copy_deps
 #endif
@@ -94,7 +115,9 @@ void omp_potrf(type_t *A)
 #if defined(OPENBLAS_IMPL) || defined(POTRF_SMP)
    static const char L = 'L';
    int info;
+   KSTATS_BEGIN();
    potrf(&L, &ts, A, &ts, &info);
+   KSTATS_END(KS_POTRF);
 #else
    #pragma HLS inline
    #pragma HLS array_partition variable=A cyclic factor=FPGA_PWIDTH/64
@@ -106,7 +129,7 @@ void omp_potrf(type_t *A)
          tmp -= Akj*Akj;
       }
 
-      A[j*ts + j] = sqrtf(tmp);
+      A[j*ts + j] = type_sqrt(tmp);
 
       for (int i = j + 1; i < ts; ++i) {
          type_t tmp = A[j*ts + i];
@@ -121,15 +144,20 @@ void omp_potrf(type_t *A)
 }
 
 #ifdef TRSM_SMP
-#pragma oss task in([ts*ts]A) inout([ts*ts]B)
+#pragma oss task in([ts*ts]A) inout([ts*ts]B) PRIO_CLAUSE
 #else
 #pragma oss task device(fpga) num_instances(TRSM_NUMACCS) copy_deps in([ts*ts]A) inout([ts*ts]B)
 #endif
 void omp_trsm(const type_t *A, type_t *B)
 {
 #ifdef TRSM_SMP
+   KSTATS_BEGIN();
    trsm(CBLAS_MAT_ORDER, CBLAS_RI, CBLAS_LO, CBLAS_T, CBLAS_NU,
       ts, ts, 1.0, A, ts, B, ts);
+   KSTATS_END(KS_TRSM);
+#elif defined(SMP_KERNELS)
+   //NOTE: Host build of the FPGA kernel, the HLS loops are not meant for a CPU
+   smp_trsm(A, B);
 #else
    #pragma HLS inline
    #pragma HLS array_partition variable=A cyclic factor=FPGA_PWIDTH/64
@@ -160,26 +188,55 @@ void omp_trsm(const type_t *A, type_t *B)
 }
 
 #ifdef OPENBLAS_IMPL
-#pragma oss task in([ts*ts]A) inout([ts*ts]B)
+#pragma oss task in([ts*ts]A) inout([ts*ts]B) PRIO_CLAUSE
 #else
 #pragma oss task device(fpga) num_instances(SYRK_NUMACCS) copy_deps in([ts*ts]A) inout([ts*ts]B)
 #endif
 void omp_syrk(const type_t *A, type_t *B)
 {
 #ifdef OPENBLAS_IMPL
+   KSTATS_BEGIN();
    syrk(CBLAS_MAT_ORDER, CBLAS_LO, CBLAS_NT,
       ts, ts, -1.0, A, ts, 1.0, B, ts);
+   KSTATS_END(KS_SYRK);
+#elif defined(SMP_KERNELS)
+   smp_syrk(A, B);
 #else
    #pragma HLS inline
    #pragma HLS array_partition variable=A cyclic factor=ts/FPGA_OTHER_II
-   #pragma HLS array_partition variable=B cyclic factor=ts/FPGA_OTHER_II
+   //NOTE: Columns p and ts-1-p have different parity, so a bank per row and column parity
+   //      lets one iteration update both of them
+   #pragma HLS array_partition variable=B cyclic factor=2*ts/FPGA_OTHER_II
+   type_t a[ts];
+   #pragma HLS array_partition variable=a complete
 
    for (int k = 0; k < ts; ++k) {
       for (int i = 0; i < ts; ++i) {
+         #pragma HLS unroll
+         a[i] = A[k*ts + i];
+      }
+
+      // Only the lower triangle is computed: column p (rows p..ts-1) and column
+      // q = ts-1-p (rows q..ts-1) are folded in ts+1 lanes, the rows of column q
+      // below its diagonal take the lanes of the rows above p. So the triangle
+      // takes ts/2 iterations, and every lane always hits the same row banks.
+      for (int p = 0; p < ts/2; ++p) {
          #pragma HLS pipeline II=FPGA_OTHER_II
-         for (int j = 0; j < ts; ++j) {
-            //NOTE: Instead of reduce the 'i' iterations, multiply by 0
-            B[i*ts + j] += -A[k*ts + i] * (j < i ? 0 : A[k*ts + j]);
+         #pragma HLS DEPENDENCE variable=B inter false
+         const int q = ts - 1 - p;
+         for (int r = 0; r < ts; ++r) {
+            const int row = r >= p ? r : ts - 1 - r;
+            const int col = r >= p ? p : q;
+            B[col*ts + row] -= a[row]*a[col];
+         }
+         B[q*ts + q] -= a[q]*a[q];
+      }
+      // With an odd ts, the middle column has no column to be folded with
+      if (ts % 2) {
+         const int m = ts/2;
+         for (int r = m; r < ts; ++r) {
+            #pragma HLS unroll
+            B[m*ts + r] -= a[r]*a[m];
          }
       }
    }
@@ -187,15 +244,19 @@ void omp_syrk(const type_t *A, type_t *B)
 }
 
 #ifdef OPENBLAS_IMPL
-#pragma oss task in([ts*ts]A, [ts*ts]B) inout([ts*ts]C)
+#pragma oss task in([ts*ts]A, [ts*ts]B) inout([ts*ts]C) PRIO_CLAUSE
 #else
 #pragma oss task device(fpga) num_instances(GEMM_NUMACCS) copy_deps in([ts*ts]A, [ts*ts]B) inout([ts*ts]C)
 #endif
 void omp_gemm(const type_t A[ts*ts], const type_t B[ts*ts], type_t C[ts*ts])
 {
 #ifdef OPENBLAS_IMPL
+   KSTATS_BEGIN();
    gemm(CBLAS_MAT_ORDER, CBLAS_NT, CBLAS_T,
       ts, ts, ts, -1.0, A, ts, B, ts, 1.0, C, ts);
+   KSTATS_END(KS_GEMM);
+#elif defined(SMP_KERNELS)
+   smp_gemm(A, B, C);
 #else
    #pragma HLS inline
    #pragma HLS array_partition variable=A cyclic factor=ts/(2*FPGA_GEMM_II)
@@ -222,251 +283,2012 @@ void omp_gemm(const type_t A[ts*ts], const type_t B[ts*ts], type_t C[ts*ts])
 #endif
 }
 
-#ifdef OPENBLAS_IMPL
-#pragma oss task inout([nt*nt*ts*ts]A)
-#else
-#pragma oss task device(fpga) inout([nt*nt*ts*ts]A)
-#endif
-void cholesky_blocked(const int nt, type_t* A)
+#ifdef COEXEC
+// SMP variants of the FPGA trsm, syrk and gemm tasks, the device of each task
+// of cholesky_blocked is chosen at run time by coexec_pick
+#pragma oss task in([ts*ts]A) inout([ts*ts]B)
+void omp_trsm_smp(const type_t *A, type_t *B)
 {
-   for (int k = 0; k < nt; k++) {
+   KSTATS_BEGIN();
+   COEXEC_BEGIN();
+   trsm(CBLAS_MAT_ORDER, CBLAS_RI, CBLAS_LO, CBLAS_T, CBLAS_NU,
+      ts, ts, 1.0, A, ts, B, ts);
+   COEXEC_END(CX_TRSM);
+   KSTATS_END(KS_TRSM);
+}
 
-      // Diagonal Block factorization
-      omp_potrf( A + ((k*nt + k)*ts*ts) );
+#pragma oss task in([ts*ts]A) inout([ts*ts]B)
+void omp_syrk_smp(const type_t *A, type_t *B)
+{
+   KSTATS_BEGIN();
+   COEXEC_BEGIN();
+   syrk(CBLAS_MAT_ORDER, CBLAS_LO, CBLAS_NT,
+      ts, ts, -1.0, A, ts, 1.0, B, ts);
+   COEXEC_END(CX_SYRK);
+   KSTATS_END(KS_SYRK);
+}
 
-      // Triangular systems
-      for (int i = k+1; i < nt; i++) {
-         omp_trsm( A + ((k*nt + k)*ts*ts),
-                   A + ((k*nt + i)*ts*ts) );
-      }
+#pragma oss task in([ts*ts]A, [ts*ts]B) inout([ts*ts]C)
+void omp_gemm_smp(const type_t *A, const type_t *B, type_t *C)
+{
+   KSTATS_BEGIN();
+   COEXEC_BEGIN();
+   gemm(CBLAS_MAT_ORDER, CBLAS_NT, CBLAS_T,
+      ts, ts, ts, -1.0, A, ts, B, ts, 1.0, C, ts);
+   COEXEC_END(CX_GEMM);
+   KSTATS_END(KS_GEMM);
+}
 
-      // Update trailing matrix
-      for (int i = k + 1; i < nt; i++) {
-         for (int j = k + 1; j < i; j++) {
-            omp_gemm( A + ((k*nt + i)*ts*ts),
-                      A + ((k*nt + j)*ts*ts),
-                      A + ((j*nt + i)*ts*ts) );
-         }
-         omp_syrk( A + ((k*nt + i)*ts*ts),
-                   A + ((i*nt + i)*ts*ts) );
-      }
+static void co_trsm(const type_t *A, type_t *B)
+{
+#ifdef TRSM_SMP
+   omp_trsm(A, B);
+#else
+   if (coexec_pick(CX_TRSM) == CX_SMP) {
+      omp_trsm_smp(A, B);
+   } else {
+      omp_trsm(A, B);
    }
-   #pragma oss taskwait
+#endif
 }
 
-// Robust Check the factorization of the matrix A2
-static int check_factorization(int N, type_t *A1, type_t *A2, int LDA, char uplo)
+static void co_syrk(const type_t *A, type_t *B)
 {
-#ifdef VERBOSE
-   printf ("Checking result ...\n");
-#endif
+   if (coexec_pick(CX_SYRK) == CX_SMP) {
+      omp_syrk_smp(A, B);
+   } else {
+      omp_syrk(A, B);
+   }
+}
 
-   char NORM = 'I', ALL = 'A', UP = 'U', LO = 'L', TR = 'T', NU = 'N', RI = 'R';
-   type_t alpha = 1.0;
-   type_t const b = 2.0;
-#ifdef USE_DOUBLE
-   const int t = 53;
+static void co_gemm(const type_t *A, const type_t *B, type_t *C)
+{
+   if (coexec_pick(CX_GEMM) == CX_SMP) {
+      omp_gemm_smp(A, B, C);
+   } else {
+      omp_gemm(A, B, C);
+   }
+}
 #else
-   const int t = 24;
+#  define co_trsm omp_trsm
+#  define co_syrk omp_syrk
+#  define co_gemm omp_gemm
 #endif
-   type_t const eps = pow_di( b, -t );
-
-   type_t *Residual = (type_t *)malloc(N*N*sizeof(type_t));
-   type_t *L1       = (type_t *)malloc(N*N*sizeof(type_t));
-   type_t *L2       = (type_t *)malloc(N*N*sizeof(type_t));
-   type_t *work     = (type_t *)malloc(N*sizeof(type_t));
 
-   memset((void*)L1, 0, N*N*sizeof(type_t));
-   memset((void*)L2, 0, N*N*sizeof(type_t));
+#ifdef GEMM_MULTI
+// Multi-update kernels: the np tiles of a row run, e.g. A(i,p..p+np-1), are
+// contiguous in the packed layout, so together they are a ts x np*ts
+// column-major matrix and all the updates of a tile are a single product with
+// k = np*ts. The updated tile stays in the accelerator for the whole run.
+// FPGA accelerators are built for runs of exactly GEMM_MULTI tiles.
 
-   lacpy(&ALL, &N, &N, A1, &LDA, Residual, &N);
-
-   /* Dealing with L'L or U'U  */
-   if (uplo == 'U'){
-      lacpy(&UP, &N, &N, A2, &LDA, L1, &N);
-      lacpy(&UP, &N, &N, A2, &LDA, L2, &N);
-      trmm(CBLAS_MAT_ORDER, CBLAS_LF, CBLAS_UP, CBLAS_T, CBLAS_NU,
-         N, N, alpha, L1, N, L2, N);
-   } else {
-      lacpy(&LO, &N, &N, A2, &LDA, L1, &N);
-      lacpy(&LO, &N, &N, A2, &LDA, L2, &N);
-      trmm(CBLAS_MAT_ORDER, CBLAS_RI, CBLAS_LO, CBLAS_T, CBLAS_NU,
-         N, N, alpha, L1, N, L2, N);
+#ifdef OPENBLAS_IMPL
+#pragma oss task in([np*ts*ts]A) inout([ts*ts]B) PRIO_CLAUSE
+#else
+#pragma oss task device(fpga) num_instances(SYRK_NUMACCS) copy_deps in([GEMM_MULTI*ts*ts]A) inout([ts*ts]B)
+#endif
+void omp_syrk_multi(const int np, const type_t *A, type_t *B)
+{
+#ifdef OPENBLAS_IMPL
+   KSTATS_BEGIN();
+   syrk(CBLAS_MAT_ORDER, CBLAS_LO, CBLAS_NT,
+      ts, np*ts, -1.0, A, ts, 1.0, B, ts);
+   KSTATS_END_N(KS_SYRK, np);
+#elif defined(SMP_KERNELS)
+   for (int p = 0; p < np; p++) {
+      smp_syrk(A + p*ts*ts, B);
    }
+#else
+   #pragma HLS inline
+   #pragma HLS array_partition variable=A cyclic factor=ts/FPGA_OTHER_II
+   #pragma HLS array_partition variable=B cyclic factor=2*ts/FPGA_OTHER_II
+   type_t a[ts];
+   #pragma HLS array_partition variable=a complete
+
+   // Same folded triangle as omp_syrk, over the GEMM_MULTI*ts columns of the run
+   for (int k = 0; k < GEMM_MULTI*ts; ++k) {
+      for (int i = 0; i < ts; ++i) {
+         #pragma HLS unroll
+         a[i] = A[k*ts + i];
+      }
 
-   /* Compute the Residual || A -L'L|| */
-   for (int i = 0; i < N; i++) {
-      for (int j = 0; j < N; j++) {
-         Residual[j*N+i] = L2[j*N+i] - Residual[j*N+i];
+      for (int p = 0; p < ts/2; ++p) {
+         #pragma HLS pipeline II=FPGA_OTHER_II
+         #pragma HLS DEPENDENCE variable=B inter false
+         const int q = ts - 1 - p;
+         for (int r = 0; r < ts; ++r) {
+            const int row = r >= p ? r : ts - 1 - r;
+            const int col = r >= p ? p : q;
+            B[col*ts + row] -= a[row]*a[col];
+         }
+         B[q*ts + q] -= a[q]*a[q];
+      }
+      // With an odd ts, the middle column has no column to be folded with
+      if (ts % 2) {
+         const int m = ts/2;
+         for (int r = m; r < ts; ++r) {
+            #pragma HLS unroll
+            B[m*ts + r] -= a[r]*a[m];
+         }
       }
    }
+#endif
+}
 
-   type_t Rnorm = lange(&NORM, &N, &N, Residual, &N, work);
-   type_t Anorm = lange(&NORM, &N, &N, A1, &N, work);
+#ifdef OPENBLAS_IMPL
+#pragma oss task in([np*ts*ts]A, [np*ts*ts]B) inout([ts*ts]C) PRIO_CLAUSE
+#else
+#pragma oss task device(fpga) num_instances(GEMM_NUMACCS) copy_deps in([GEMM_MULTI*ts*ts]A, [GEMM_MULTI*ts*ts]B) inout([ts*ts]C)
+#endif
+void omp_gemm_multi(const int np, const type_t *A, const type_t *B, type_t *C)
+{
+#ifdef OPENBLAS_IMPL
+   KSTATS_BEGIN();
+   gemm(CBLAS_MAT_ORDER, CBLAS_NT, CBLAS_T,
+      ts, ts, np*ts, -1.0, A, ts, B, ts, 1.0, C, ts);
+   KSTATS_END_N(KS_GEMM, np);
+#elif defined(SMP_KERNELS)
+   for (int p = 0; p < np; p++) {
+      smp_gemm(A + p*ts*ts, B + p*ts*ts, C);
+   }
+#else
+   #pragma HLS inline
+   #pragma HLS array_partition variable=A cyclic factor=ts/(2*FPGA_GEMM_II)
+   #pragma HLS array_partition variable=B cyclic factor=FPGA_PWIDTH/64
+   #pragma HLS array_partition variable=C cyclic factor=ts/FPGA_GEMM_II
+   #ifdef USE_URAM
+   #if defined(__VITIS_HLS__)
+      #pragma HLS bind_storage variable=A type=RAM_T2P impl=URAM
+      #pragma HLS bind_storage variable=B type=RAM_T2P impl=URAM
+   #else
+      #pragma HLS resource variable=A core=XPM_MEMORY uram
+      #pragma HLS resource variable=B core=XPM_MEMORY uram
+   #endif
+   #endif
 
-   printf("==================================================\n");
-   printf("Checking the Cholesky Factorization \n");
-#ifdef VERBOSE
-   printf("-- Rnorm = %e \n", Rnorm);
-   printf("-- Anorm = %e \n", Anorm);
-   printf("-- Anorm*N*eps = %e \n", Anorm*N*eps);
-   printf("-- ||L'L-A||_oo/(||A||_oo.N.eps) = %e \n",Rnorm/(Anorm*N*eps));
+   for (int k = 0; k < GEMM_MULTI*ts; ++k) {
+      for (int i = 0; i < ts; ++i) {
+         #pragma HLS pipeline II=FPGA_GEMM_II
+         for (int j = 0; j < ts; ++j) {
+            C[i*ts + j] += A[k*ts + j] * -B[k*ts + i];
+         }
+      }
+   }
 #endif
+}
 
-   const int info_factorization = isnan(Rnorm/(Anorm*N*eps)) ||
-      isinf(Rnorm/(Anorm*N*eps)) || (Rnorm/(Anorm*N*eps) > 60.0);
+// Updates tile C with the first np tiles of the row runs A and B (B = A for
+// diagonal tiles), GEMM_MULTI tiles per task. FPGA accelerators only take
+// whole runs, so the remaining tiles use the single update kernels.
+static void update_run(const int np, const type_t *A, const type_t *B, type_t *C)
+{
+   int p = 0;
+   for (; p + GEMM_MULTI <= np; p += GEMM_MULTI) {
+      if (A == B) {
+         omp_syrk_multi(GEMM_MULTI, A + p*ts*ts, C);
+      } else {
+         omp_gemm_multi(GEMM_MULTI, A + p*ts*ts, B + p*ts*ts, C);
+      }
+   }
+#ifdef OPENBLAS_IMPL
+   if (p < np) {
+      if (A == B) {
+         omp_syrk_multi(np - p, A + p*ts*ts, C);
+      } else {
+         omp_gemm_multi(np - p, A + p*ts*ts, B + p*ts*ts, C);
+      }
+   }
+#else
+   for (; p < np; p++) {
+      if (A == B) {
+         omp_syrk(A + p*ts*ts, C);
+      } else {
+         omp_gemm(A + p*ts*ts, B + p*ts*ts, C);
+      }
+   }
+#endif
+}
+#endif
 
-   if ( info_factorization ){
-      fprintf(stderr, "\n-- Factorization is suspicious ! \n\n");
-   } else {
-      printf("\n-- Factorization is CORRECT ! \n\n");
+#if defined(OPENBLAS_IMPL) || defined(COEXEC)
+//NOTE: Weak access, so the tile tasks can start as soon as their own tiles are ready.
+//      With COEXEC, the device of each tile task is picked on the host
+#pragma oss task weakinout([NUM_TILES(nt)*ts*ts]A)
+#else
+#pragma oss task device(fpga) inout([NUM_TILES(nt)*ts*ts]A)
+#endif
+// Right-looking factorization with a lookahead of la panels: at step k, the
+// next la columns are updated with panel k right after it is factorized, but
+// the rest of the trailing matrix is only updated with panel k at step k+la.
+// Thus, the next panels are not queued behind the whole trailing update.
+void cholesky_blocked(const int nt, const int la, type_t* A)
+{
+#ifdef GEMM_MULTI
+   //NOTE: Left-looking, so the lookahead does not apply. Each tile gets all its
+   //      updates in a row, with multi-update tasks, right before its potrf/trsm.
+   (void)la;
+   for (int j = 0; j < nt; j++) {
+      TASK_PRIO(2*(nt - j) + 1);
+      update_run(j, A + TILE_IDX(j, 0)*ts*ts, A + TILE_IDX(j, 0)*ts*ts, A + TILE_IDX(j, j)*ts*ts);
+      omp_potrf( A + TILE_IDX(j, j)*ts*ts );
+
+      TASK_PRIO(2*(nt - j));
+      for (int i = j+1; i < nt; i++) {
+         update_run(j, A + TILE_IDX(i, 0)*ts*ts, A + TILE_IDX(j, 0)*ts*ts, A + TILE_IDX(i, j)*ts*ts);
+         omp_trsm( A + TILE_IDX(j, j)*ts*ts,
+                   A + TILE_IDX(i, j)*ts*ts );
+      }
    }
+#else
+   for (int k = 0; k < nt + la; k++) {
 
-   free(work);
-   free(L2);
-   free(L1);
-   free(Residual);
+      if (k < nt) {
+         // Diagonal Block factorization
+         TASK_PRIO(2*(nt - k) + 1);
+         omp_potrf( A + TILE_IDX(k, k)*ts*ts );
 
-   return info_factorization;
+         // Triangular systems
+         for (int i = k+1; i < nt; i++) {
+            co_trsm( A + TILE_IDX(k, k)*ts*ts,
+                     A + TILE_IDX(i, k)*ts*ts );
+         }
+      }
+
+      // Update trailing matrix, the lookahead columns with panel k and the
+      // other ones with panel k-la
+      for (int u = 0; u < 2; u++) {
+         const int p    = u == 0 ? k : k - la;
+         const int jend = u == 0 ? k + la : nt - 1;
+         if (p < 0 || p >= nt) continue;
+
+         for (int j = k + 1; j <= jend && j < nt; j++) {
+            TASK_PRIO(2*(nt - j));
+            co_syrk( A + TILE_IDX(j, p)*ts*ts,
+                     A + TILE_IDX(j, j)*ts*ts );
+            for (int i = j + 1; i < nt; i++) {
+               co_gemm( A + TILE_IDX(i, p)*ts*ts,
+                        A + TILE_IDX(j, p)*ts*ts,
+                        A + TILE_IDX(i, j)*ts*ts );
+            }
+         }
+      }
+   }
+#endif
+   #pragma oss taskwait
 }
 
-void initialize_matrix(const int n, type_t *matrix)
+// Factorizes the blocked matrix and waits until it is back in host memory,
+// for callers that do not handle the tasks (see libcholesky.c)
+void cholesky_blocked_sync(const int nt, const int la, type_t* A)
 {
-   int ISEED[4] = {0,0,0,1};
-   int intONE=1;
-
-#ifdef VERBOSE
-   printf("Initializing matrix with random values ...\n");
-#endif
+   cholesky_blocked(nt, la, A);
+   flushData(A, NUM_TILES(nt)*ts*ts);
+   #pragma oss taskwait
+}
 
-   for (int i = 0; i < n*n; i+=n) {
-      larnv(&intONE, &ISEED[0], &n, &matrix[i]);
+// Two-level factorization over super-tiles of hs x hs tiles. Super-tile (si,sj)
+// is stored as up to hs row runs, the r-th one holding the tiles of tile row
+// si*hs+r that fall in super-tile column sj (only up to the diagonal when si == sj)
+#define HIER_ROWS(nt, hs, si)      ((nt) - (si)*(hs) < (hs) ? (nt) - (si)*(hs) : (hs))
+#define HIER_COLS(hs, si, sj, r)   ((si) == (sj) ? (r) + 1 : (hs))
+#define HIER_TILES(nt, hs, si, sj) {A[TILE_IDX((si)*(hs) + r, (sj)*(hs))*ts*ts;HIER_COLS(hs, si, sj, r)*ts*ts], r=0;HIER_ROWS(nt, hs, si)}
+
+//NOTE: The outer tasks only have weak accesses, so they start right away and
+//      just create the tile tasks of their super-tile, which are linked to the
+//      ones of the other outer tasks through the weak accesses
+#pragma oss task weakinout(HIER_TILES(nt, hs, sk, sk))
+void hier_potrf(const int nt, const int hs, const int sk, type_t *A)
+{
+   const int k0 = sk*hs, k1 = k0 + HIER_ROWS(nt, hs, sk);
+   for (int k = k0; k < k1; k++) {
+      TASK_PRIO(2*(nt - k) + 1);
+      omp_potrf( A + TILE_IDX(k, k)*ts*ts );
+      for (int i = k + 1; i < k1; i++) {
+         omp_trsm( A + TILE_IDX(k, k)*ts*ts,
+                   A + TILE_IDX(i, k)*ts*ts );
+      }
+      for (int j = k + 1; j < k1; j++) {
+         TASK_PRIO(2*(nt - j));
+         omp_syrk( A + TILE_IDX(j, k)*ts*ts,
+                   A + TILE_IDX(j, j)*ts*ts );
+         for (int i = j + 1; i < k1; i++) {
+            omp_gemm( A + TILE_IDX(i, k)*ts*ts,
+                      A + TILE_IDX(j, k)*ts*ts,
+                      A + TILE_IDX(i, j)*ts*ts );
+         }
+      }
    }
+}
 
-   type_t a = (type_t)n;
-   for (int i=0; i<n; i++) {
-      for (int j=0; j<n; j++) {
-         matrix[j*n + i] = matrix[j*n + i] + matrix[i*n + j];
-         matrix[i*n + j] = matrix[j*n + i];
+#pragma oss task weakin(HIER_TILES(nt, hs, sk, sk)) weakinout(HIER_TILES(nt, hs, si, sk))
+void hier_trsm(const int nt, const int hs, const int sk, const int si, type_t *A)
+{
+   const int k0 = sk*hs, k1 = k0 + HIER_ROWS(nt, hs, sk);
+   const int i0 = si*hs, i1 = i0 + HIER_ROWS(nt, hs, si);
+   for (int k = k0; k < k1; k++) {
+      TASK_PRIO(2*(nt - k));
+      for (int i = i0; i < i1; i++) {
+         omp_trsm( A + TILE_IDX(k, k)*ts*ts,
+                   A + TILE_IDX(i, k)*ts*ts );
+      }
+      for (int j = k + 1; j < k1; j++) {
+         TASK_PRIO(2*(nt - j));
+         for (int i = i0; i < i1; i++) {
+            omp_gemm( A + TILE_IDX(i, k)*ts*ts,
+                      A + TILE_IDX(j, k)*ts*ts,
+                      A + TILE_IDX(i, j)*ts*ts );
+         }
       }
-      //add_to_diag
-      matrix[i*n + i] += a;
    }
 }
 
-int main(int argc, char* argv[])
+#pragma oss task weakin(HIER_TILES(nt, hs, sj, sk)) weakinout(HIER_TILES(nt, hs, sj, sj))
+void hier_syrk(const int nt, const int hs, const int sk, const int sj, type_t *A)
 {
-   char *result[3] = {"n/a","sucessful","UNSUCCESSFUL"};
+   const int k0 = sk*hs, k1 = k0 + HIER_ROWS(nt, hs, sk);
+   const int j0 = sj*hs, j1 = j0 + HIER_ROWS(nt, hs, sj);
+   for (int k = k0; k < k1; k++) {
+      for (int j = j0; j < j1; j++) {
+         TASK_PRIO(2*(nt - j));
+         omp_syrk( A + TILE_IDX(j, k)*ts*ts,
+                   A + TILE_IDX(j, j)*ts*ts );
+         for (int i = j + 1; i < j1; i++) {
+            omp_gemm( A + TILE_IDX(i, k)*ts*ts,
+                      A + TILE_IDX(j, k)*ts*ts,
+                      A + TILE_IDX(i, j)*ts*ts );
+         }
+      }
+   }
+}
 
-   if ( argc < 3 ) {
-      fprintf( stderr, "USAGE:\t%s <matrix size> [<check>]\n", argv[0] );
-      return 1;
+#pragma oss task weakin(HIER_TILES(nt, hs, si, sk), HIER_TILES(nt, hs, sj, sk)) weakinout(HIER_TILES(nt, hs, si, sj))
+void hier_gemm(const int nt, const int hs, const int sk, const int si, const int sj, type_t *A)
+{
+   const int k0 = sk*hs, k1 = k0 + HIER_ROWS(nt, hs, sk);
+   const int i0 = si*hs, i1 = i0 + HIER_ROWS(nt, hs, si);
+   const int j0 = sj*hs, j1 = j0 + HIER_ROWS(nt, hs, sj);
+   for (int k = k0; k < k1; k++) {
+      for (int j = j0; j < j1; j++) {
+         TASK_PRIO(2*(nt - j));
+         for (int i = i0; i < i1; i++) {
+            omp_gemm( A + TILE_IDX(i, k)*ts*ts,
+                      A + TILE_IDX(j, k)*ts*ts,
+                      A + TILE_IDX(i, j)*ts*ts );
+         }
+      }
    }
-   const int  n = atoi(argv[1]); // matrix size
-   int check    = argc > 2 ? atoi(argv[2]) : 1; // check result?
-   const int nt = n / ts; // number of tiles
-   if ( n % ts != 0 ) {
-      fprintf( stderr, "ERROR:\t<matrix size> is not multiple of <block size>\n" );
-      exit( -1 );
+}
+
+// Right-looking factorization over the super-tiles. The creator only submits
+// about (nt/hs)^3/6 outer tasks and the tile tasks are created by them, in
+// parallel and only once their super-tile is reached
+void cholesky_hier(const int nt, const int hs, type_t *A)
+{
+   const int ns = (nt + hs - 1)/hs; // super-tiles per dimension
+   for (int sk = 0; sk < ns; sk++) {
+      hier_potrf(nt, hs, sk, A);
+      for (int si = sk + 1; si < ns; si++) {
+         hier_trsm(nt, hs, sk, si, A);
+      }
+      for (int sj = sk + 1; sj < ns; sj++) {
+         hier_syrk(nt, hs, sk, sj, A);
+         for (int si = sj + 1; si < ns; si++) {
+            hier_gemm(nt, hs, sk, si, sj, A);
+         }
+      }
    }
+   #pragma oss taskwait
+}
 
-   // Allocate matrix
-   type_t * const matrix = (type_t *) malloc(n * n * sizeof(type_t));
-   assert(matrix != NULL);
+#ifndef CHOLESKY_LIB
+#pragma oss task out([c*ts*ts]buf)
+void ooc_read_task(ooc_store_t *st, const int i, const int j, const int c, type_t *buf)
+{
+   ooc_read(st, i, j, c, buf);
+}
 
-   double tIniStart = wall_time();
+#pragma oss task in([c*ts*ts]buf)
+void ooc_write_task(ooc_store_t *st, const int i, const int j, const int c, const type_t *buf)
+{
+   ooc_write(st, i, j, c, buf);
+}
 
-   // Init matrix
-   initialize_matrix(n, matrix);
+// Tile (i,j) of the cached panel of columns c0..c0+w-1. Its rows are stored one
+// after the other, the first w ones only up to the diagonal
+static inline type_t *ooc_panel_tile(type_t *P, const int c0, const int w, const int i, const int j)
+{
+   const int r = i - c0;
+   return P + ((r < w ? r*(r + 1)/2 : w*(w + 1)/2 + (r - w)*w) + j - c0)*ts*ts;
+}
 
-   type_t * original_matrix = NULL;
-   if ( check == 1 ) {
-      // Allocate matrix
-      original_matrix = (type_t *) malloc(n * n * sizeof(type_t));
-      assert(original_matrix != NULL);
-      memcpy(original_matrix, matrix, n * n * sizeof(type_t));
-   }
+// Out-of-core left-looking factorization of the matrix in st, through a cache
+// of ctiles tiles at C. Each step factorizes the widest panel of w columns that
+// fits in a third of the cache: its tiles are read, updated with the previous
+// columns, which are streamed w at a time through the other two thirds, then
+// factorized and written back. The tile rows of the stream blocks are read by
+// tasks, so the next block is read while the current one updates the panel.
+void cholesky_ooc(const int nt, const int ctiles, type_t *C, ooc_store_t *st)
+{
+   type_t * const P = C;
+   type_t * const S[2] = { C + (ctiles/3)*ts*ts, C + 2*(ctiles/3)*ts*ts };
 
-   // Allocate blocked matrix
-   type_t *Ah[nt][nt];
-   type_t *Ab;
-   const size_t s = ts * ts * sizeof(type_t);
-   Ab = malloc(s*nt*nt);
-   assert(Ab != NULL);
+   for (int c0 = 0; c0 < nt; ) {
+      const int rows = nt - c0;
+      const int w = ctiles/3/rows < rows ? ctiles/3/rows : rows;
+      const int c1 = c0 + w;
 
-   for (int i = 0; i < nt; i++) {
-      for (int j = 0; j < nt; j++) {
-         Ah[i][j] = Ab + (i*nt + j)*ts*ts;
+      for (int i = c0; i < nt; i++) {
+         ooc_read_task(st, i, c0, (i < c1 ? i + 1 : c1) - c0, ooc_panel_tile(P, c0, w, i, c0));
       }
-   }
-
-   const double tEndStart = wall_time();
 
-#ifdef VERBOSE
-   printf ("Executing ...\n");
+      // Updates with the previous columns, w at a time. The rows of a stream
+      // block are runs of consecutive tiles, like the rows of the matrix
+      for (int k0 = 0, b = 0; k0 < c0; k0 += w, b ^= 1) {
+         const int nk = k0 + w < c0 ? w : c0 - k0;
+         for (int i = c0; i < nt; i++) {
+            ooc_read_task(st, i, k0, nk, S[b] + (i - c0)*w*ts*ts);
+         }
+         for (int j = c0; j < c1; j++) {
+            const type_t *Sj = S[b] + (j - c0)*w*ts*ts;
+            TASK_PRIO(2*(nt - j));
+#ifdef GEMM_MULTI
+            update_run(nk, Sj, Sj, ooc_panel_tile(P, c0, w, j, j));
+            for (int i = j + 1; i < nt; i++) {
+               update_run(nk, S[b] + (i - c0)*w*ts*ts, Sj, ooc_panel_tile(P, c0, w, i, j));
+            }
+#else
+            for (int k = 0; k < nk; k++) {
+               omp_syrk( Sj + k*ts*ts, ooc_panel_tile(P, c0, w, j, j) );
+               for (int i = j + 1; i < nt; i++) {
+                  omp_gemm( S[b] + ((i - c0)*w + k)*ts*ts,
+                            Sj + k*ts*ts,
+                            ooc_panel_tile(P, c0, w, i, j) );
+               }
+            }
 #endif
+            st->accesses += (uint64_t)nk*(2 + 3*(nt - j - 1));
+         }
+      }
 
-   convert_to_blocks(nt, n, (type_t(*)[n]) matrix, Ah);
-
-   const double tIniWarm = wall_time();
+      // Factorization of the panel
+      for (int k = c0; k < c1; k++) {
+         TASK_PRIO(2*(nt - k) + 1);
+         omp_potrf( ooc_panel_tile(P, c0, w, k, k) );
+         for (int i = k + 1; i < nt; i++) {
+            omp_trsm( ooc_panel_tile(P, c0, w, k, k),
+                      ooc_panel_tile(P, c0, w, i, k) );
+         }
+         st->accesses += 1 + 2*(nt - k - 1);
+         for (int j = k + 1; j < c1; j++) {
+            TASK_PRIO(2*(nt - j));
+            omp_syrk( ooc_panel_tile(P, c0, w, j, k),
+                      ooc_panel_tile(P, c0, w, j, j) );
+            for (int i = j + 1; i < nt; i++) {
+               omp_gemm( ooc_panel_tile(P, c0, w, i, k),
+                         ooc_panel_tile(P, c0, w, j, k),
+                         ooc_panel_tile(P, c0, w, i, j) );
+            }
+            st->accesses += 2 + 3*(nt - j - 1);
+         }
+      }
 
-   //Warm up execution
-   if (check == 2) {
-       cholesky_blocked(nt, Ab);
-       #pragma oss taskwait
+      for (int i = c0; i < nt; i++) {
+         ooc_write_task(st, i, c0, (i < c1 ? i + 1 : c1) - c0, ooc_panel_tile(P, c0, w, i, c0));
+      }
+      //NOTE: The next panel reuses the cache with a different shape
+      #pragma oss taskwait
+      c0 = c1;
    }
+}
+#endif
 
-   const double tEndWarm = wall_time();
-   const double tIniExec = tEndWarm;
-
-   //Performance execution
-   cholesky_blocked(nt, Ab);
+// Right-looking factorization of a tile-sparse matrix. T holds the tile
+// pointers in the order of the blocked matrix, NULL for the tiles that are
+// still zero after the fill-in, and only the tasks of nonzero tiles are created
+void cholesky_sparse(const int nt, type_t * const *T)
+{
+   for (int k = 0; k < nt; k++) {
+      TASK_PRIO(2*(nt - k) + 1);
+      omp_potrf( T[TILE_IDX(k, k)] );
+      for (int i = k + 1; i < nt; i++) {
+         if (T[TILE_IDX(i, k)] == NULL) continue;
+         omp_trsm( T[TILE_IDX(k, k)],
+                   T[TILE_IDX(i, k)] );
+      }
 
+      for (int j = k + 1; j < nt; j++) {
+         if (T[TILE_IDX(j, k)] == NULL) continue;
+         TASK_PRIO(2*(nt - j));
+         omp_syrk( T[TILE_IDX(j, k)],
+                   T[TILE_IDX(j, j)] );
+         for (int i = j + 1; i < nt; i++) {
+            if (T[TILE_IDX(i, k)] == NULL) continue;
+            omp_gemm( T[TILE_IDX(i, k)],
+                      T[TILE_IDX(j, k)],
+                      T[TILE_IDX(i, j)] );
+         }
+      }
+   }
    #pragma oss taskwait
-   const double tEndExec = wall_time();
-   const double tIniFlush = tEndExec;
+}
 
-   flushData(Ab, nt*nt*ts*ts);
+#ifdef CHOLESKY_MPI
+// Does process (p,q) need the tile (i,k) of panel k for its tasks of step k?
+// The diagonal tile is needed by the trsm of its panel tiles, the other ones
+// by the syrk and gemm updates of its tiles in row i and in column i
+static int dist_needs(const int nt, const dist_t *d, const int p, const int q, const int k, const int i)
+{
+   if (i == k) {
+      if (k % d->Q != q) return 0;
+      for (int j = k + 1; j < nt && j <= k + d->P; j++) {
+         if (j % d->P == p) return 1;
+      }
+      return 0;
+   }
+   if (i % d->P == p) {
+      for (int j = k + 1; j <= i && j <= k + d->Q; j++) {
+         if (j % d->Q == q) return 1;
+      }
+   }
+   if (i % d->Q == q) {
+      for (int j = i + 1; j < nt && j <= i + d->P; j++) {
+         if (j % d->P == p) return 1;
+      }
+   }
+   return 0;
+}
 
-   #pragma oss taskwait
+// Sends the final tile (i,k) to every other process that needs it, returns the requests started
+static int dist_send(const int nt, dist_t *d, const int k, const int i, const type_t *A, MPI_Request *req)
+{
+   int nreq = 0;
+   for (int p = 0; p < d->P; p++) {
+      for (int q = 0; q < d->Q; q++) {
+         if ((p == d->p && q == d->q) || !dist_needs(nt, d, p, q, k, i)) continue;
+         MPI_Isend(A, ts*ts, MPI_TYPE_T, p*d->Q + q, i, d->comm, &req[nreq++]);
+         d->bytes_sent += ts*ts*sizeof(type_t);
+      }
+   }
+   return nreq;
+}
 
-   const double tEndFlush = wall_time();
-   const double tIniToLinear = tEndFlush;
+static void dist_wait(dist_t *d, const int nreq, MPI_Request *req)
+{
+   const double t = wall_time();
+   MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+   d->comm_time += wall_time() - t;
+}
 
-   convert_to_linear(nt, n, Ah, (type_t (*)[n]) matrix);
+// Right-looking factorization of a matrix distributed over the process grid of
+// d. T holds the tile pointers in the order of the blocked matrix, NULL for the
+// tiles owned by other processes. The panel tiles are sent to the process rows
+// and columns that update with them as soon as their potrf or trsm finishes,
+// and received into one of two panel buffers, so the updates of the previous
+// steps keep running while the panel of the next one is exchanged.
+void cholesky_dist(const int nt, type_t * const *T, dist_t *d)
+{
+   type_t *buf = (type_t *)malloc(2*nt*ts*ts*sizeof(type_t));
+   MPI_Request *req = (MPI_Request *)malloc((nt + 1)*d->P*d->Q*sizeof(MPI_Request));
+   assert(buf != NULL && req != NULL);
+
+   for (int k = 0; k < nt; k++) {
+      type_t * const B = buf + (k % 2)*nt*ts*ts;
+      MPI_Request dreq = MPI_REQUEST_NULL;
+      int nreq = 0;
+
+      // Receives the panel tiles owned by other processes, tag i for tile (i,k)
+      for (int i = k; i < nt; i++) {
+         type_t * const Bi = B + i*ts*ts;
+         if (T[TILE_IDX(i, k)] != NULL || !dist_needs(nt, d, d->p, d->q, k, i)) continue;
+         //NOTE: The updates of step k - 2 may still read the buffer tile
+         #pragma oss taskwait inout([ts*ts]Bi)
+         MPI_Irecv(Bi, ts*ts, MPI_TYPE_T, DIST_RANK(d, i, k), i, d->comm, i == k ? &dreq : &req[nreq++]);
+         d->bytes_recv += ts*ts*sizeof(type_t);
+      }
+
+      type_t * const Lkk = T[TILE_IDX(k, k)] != NULL ? T[TILE_IDX(k, k)] : B + k*ts*ts;
+      if (T[TILE_IDX(k, k)] != NULL) {
+         TASK_PRIO(2*(nt - k) + 1);
+         omp_potrf( Lkk );
+         #pragma oss taskwait in([ts*ts]Lkk)
+         nreq += dist_send(nt, d, k, k, Lkk, req + nreq);
+      } else {
+         dist_wait(d, 1, &dreq);
+      }
+
+      TASK_PRIO(2*(nt - k) + 1);
+      for (int i = k + 1; i < nt; i++) {
+         if (T[TILE_IDX(i, k)] == NULL) continue;
+         omp_trsm( Lkk,
+                   T[TILE_IDX(i, k)] );
+      }
+      for (int i = k + 1; i < nt; i++) {
+         type_t * const Lik = T[TILE_IDX(i, k)];
+         if (Lik == NULL) continue;
+         #pragma oss taskwait in([ts*ts]Lik)
+         nreq += dist_send(nt, d, k, i, Lik, req + nreq);
+      }
+      dist_wait(d, nreq, req);
+
+      for (int j = k + 1; j < nt; j++) {
+         const type_t * const Ljk = T[TILE_IDX(j, k)] != NULL ? T[TILE_IDX(j, k)] : B + j*ts*ts;
+         TASK_PRIO(2*(nt - j));
+         if (T[TILE_IDX(j, j)] != NULL) {
+            omp_syrk( Ljk,
+                      T[TILE_IDX(j, j)] );
+         }
+         for (int i = j + 1; i < nt; i++) {
+            if (T[TILE_IDX(i, j)] == NULL) continue;
+            omp_gemm( T[TILE_IDX(i, k)] != NULL ? T[TILE_IDX(i, k)] : B + i*ts*ts,
+                      Ljk,
+                      T[TILE_IDX(i, j)] );
+         }
+      }
+   }
+   #pragma oss taskwait
+
+   free(req);
+   free(buf);
+}
+#endif
+
+#ifdef POTRF_SMP
+// Factorizes the n x n matrices packed along the diagonal of a tile one by one
+#pragma oss task inout([ts*ts]A)
+void omp_potrf_packed(const int n, type_t *A)
+{
+   static const char L = 'L';
+   int info;
+   KSTATS_BEGIN();
+   for (int m = 0; m < ts/n; m++) {
+      potrf(&L, &n, A + m*n*ts + m*n, &ts, &info);
+   }
+   KSTATS_END(KS_POTRF);
+}
+#endif
+
+// Factorizes a batch of nb independent n x n matrices, laid out as gen_batch
+// generates them, without waiting between matrices. Matrices smaller than a
+// tile are packed ts/n per tile, so each potrf task factorizes several of them.
+void cholesky_batch(const int n, const int nb, const int la, type_t *A)
+{
+   if (n < ts) {
+      for (int t = 0; t < BATCH_TILES(n, nb); t++) {
+#ifdef POTRF_SMP
+         omp_potrf_packed(n, A + t*ts*ts);
+#else
+         //NOTE: The accelerator factorizes the whole tile, the zeros between the packed matrices stay zero
+         omp_potrf(A + t*ts*ts);
+#endif
+      }
+   } else {
+      const int nt = n/ts;
+      for (int b = 0; b < nb; b++) {
+         cholesky_blocked(nt, la, A + b*NUM_TILES(nt)*ts*ts);
+      }
+   }
+}
+
+#pragma oss task in([ts*ts]A) inout([ts*ts]B)
+void omp_trsm_bwd(const type_t *A, type_t *B)
+{
+   trsm(CBLAS_MAT_ORDER, CBLAS_RI, CBLAS_LO, CBLAS_NT, CBLAS_NU,
+      ts, ts, 1.0, A, ts, B, ts);
+}
+
+#pragma oss task in([ts*ts]A, [ts*ts]B) inout([ts*ts]C)
+void omp_gemm_bwd(const type_t *A, const type_t *B, type_t *C)
+{
+   gemm(CBLAS_MAT_ORDER, CBLAS_NT, CBLAS_NT,
+      ts, ts, ts, -1.0, A, ts, B, ts, 1.0, C, ts);
+}
+
+// Solves L*L'*X = B for the factor L of cholesky_blocked. The right-hand sides
+// are stored transposed, by tiles of ts of them: tile (q,i) at X + (q*nt + i)*ts*ts
+// holds B(i*ts:(i+1)*ts-1, q*ts:(q+1)*ts-1)'. Then the forward substitution,
+// Y'*L' = B', uses the omp_trsm and omp_gemm kernels of the factorization as is.
+// No taskwait is done, so the tasks of the first tiles can run while the last
+// panels are still being factorized.
+void cholesky_solve_blocked(const int nt, const int nq, const type_t *L, type_t *X)
+{
+   for (int q = 0; q < nq; q++) {
+      type_t * const Xq = X + q*nt*ts*ts;
+
+      // Forward substitution, Y' = B'*inv(L')
+      for (int k = 0; k < nt; k++) {
+         omp_trsm( L + TILE_IDX(k, k)*ts*ts, Xq + k*ts*ts );
+         for (int i = k + 1; i < nt; i++) {
+            omp_gemm( Xq + k*ts*ts, L + TILE_IDX(i, k)*ts*ts, Xq + i*ts*ts );
+         }
+      }
+
+      // Backward substitution, X' = Y'*inv(L)
+      for (int k = nt - 1; k >= 0; k--) {
+         omp_trsm_bwd( L + TILE_IDX(k, k)*ts*ts, Xq + k*ts*ts );
+         for (int j = 0; j < k; j++) {
+            omp_gemm_bwd( Xq + k*ts*ts, L + TILE_IDX(k, j)*ts*ts, Xq + j*ts*ts );
+         }
+      }
+   }
+}
+
+// Rank-nk update, or downdate if down, of the diagonal tile L(k,k) with the nk
+// columns of V in its rows, through the rotations of the LINPACK xCHUD/xCHDD
+// routines. They are applied one column of L and one column of V at a time and
+// kept in R for the tiles below. info gets the column + 1 where L*L' - V*V'
+// stops being positive definite, and then the factor must be recomputed.
+#pragma oss task inout([ts*ts]L, [ts*nk]V) out([2*ts*nk]R, [1]info) PRIO_CLAUSE
+void omp_chup_diag(const int nk, const int down, type_t *L, type_t *V, type_t *R, int *info)
+{
+   *info = 0;
+   for (int c = 0; c < ts; c++) {
+      for (int v = 0; v < nk; v++) {
+         type_t * const x = V + v*ts;
+         const type_t l = L[c*ts + c];
+         const type_t r2 = down ? l*l - x[c]*x[c] : l*l + x[c]*x[c];
+         if (!(r2 > 0)) {
+            *info = c + 1;
+            return;
+         }
+         const type_t r = type_sqrt(r2);
+         const type_t cs = r/l, sn = x[c]/l;
+         L[c*ts + c] = r;
+         R[2*(c*nk + v)] = cs;
+         R[2*(c*nk + v) + 1] = sn;
+         for (int e = c + 1; e < ts; e++) {
+            L[c*ts + e] = (down ? L[c*ts + e] - sn*x[e] : L[c*ts + e] + sn*x[e])/cs;
+            x[e] = cs*x[e] - sn*L[c*ts + e];
+         }
+      }
+   }
+}
+
+// Applies the rotations R of the diagonal tile of its tile column to L(i,k)
+// and the nk columns of V in its rows
+#pragma oss task in([2*ts*nk]R) inout([ts*ts]L, [ts*nk]V) PRIO_CLAUSE
+void omp_chup_panel(const int nk, const int down, const type_t *R, type_t *L, type_t *V)
+{
+   for (int c = 0; c < ts; c++) {
+      for (int v = 0; v < nk; v++) {
+         type_t * const x = V + v*ts;
+         const type_t cs = R[2*(c*nk + v)], sn = R[2*(c*nk + v) + 1];
+         for (int e = 0; e < ts; e++) {
+            L[c*ts + e] = (down ? L[c*ts + e] - sn*x[e] : L[c*ts + e] + sn*x[e])/cs;
+            x[e] = cs*x[e] - sn*L[c*ts + e];
+         }
+      }
+   }
+}
+
+// Turns the factor L of A into the one of A + V*V', or A - V*V' if down, with
+// O(n^2*nk) operations instead of the O(n^3) of a refactorization. V holds the
+// n x nk matrix by row tiles of ts x nk elements, as the check probes, and is
+// overwritten. Each tile column depends on the previous one only through the
+// rows of V, so its tiles are updated while the next diagonal tile is.
+// Returns 0, or the row + 1 where the downdated matrix stops being positive
+// definite, and then L is not valid and the matrix must be refactorized.
+int cholesky_update(const int nt, const int nk, const int down, type_t *L, type_t *V)
+{
+   type_t *R = (type_t *)malloc(nt*2*ts*nk*sizeof(type_t)); // rotations of each tile column
+   int *info = (int *)calloc(nt, sizeof(int));
+   int ret = 0;
+
+   assert(R != NULL && info != NULL);
+   for (int k = 0; k < nt; k++) {
+      TASK_PRIO(nt - k + 1);
+      omp_chup_diag(nk, down, L + TILE_IDX(k, k)*ts*ts, V + k*ts*nk, R + k*2*ts*nk, &info[k]);
+      TASK_PRIO(nt - k);
+      for (int i = k + 1; i < nt; i++) {
+         omp_chup_panel(nk, down, R + k*2*ts*nk, L + TILE_IDX(i, k)*ts*ts, V + i*ts*nk);
+      }
+   }
+   #pragma oss taskwait
+
+   for (int k = 0; k < nt && ret == 0; k++) {
+      ret = info[k] != 0 ? k*ts + info[k] : 0;
+   }
+   free(info);
+   free(R);
+
+   return ret;
+}
+
+#ifndef CHOLESKY_LIB
+// Benchmark driver, left out of the library build
+
+// Copies the lower triangle of a diagonal tile, zeroing the upper one
+static void copy_lower_tile(const type_t *A, type_t *L)
+{
+   for (int j = 0; j < ts; j++) {
+      for (int i = 0; i < ts; i++) {
+         L[j*ts + i] = i < j ? 0 : A[j*ts + i];
+      }
+   }
+}
+
+// Prints the check verdict for ||L'L-A||_oo = Rnorm and ||A||_oo = Anorm
+static int check_result(const int n, const type_t Rnorm, const type_t Anorm)
+{
+   type_t const b = 2.0;
+#ifdef USE_DOUBLE
+   const int t = 53;
+#else
+   const int t = 24;
+#endif
+   type_t const eps = pow_di( b, -t );
+
+   printf("==================================================\n");
+   printf("Checking the Cholesky Factorization \n");
+#ifdef VERBOSE
+   printf("-- Rnorm = %e \n", Rnorm);
+   printf("-- Anorm = %e \n", Anorm);
+   printf("-- Anorm*N*eps = %e \n", Anorm*n*eps);
+   printf("-- ||L'L-A||_oo/(||A||_oo.N.eps) = %e \n",Rnorm/(Anorm*n*eps));
+#endif
+
+   const int info_factorization = isnan(Rnorm/(Anorm*n*eps)) ||
+      isinf(Rnorm/(Anorm*n*eps)) || (Rnorm/(Anorm*n*eps) > 60.0);
+
+   if ( info_factorization ){
+      fprintf(stderr, "\n-- Factorization is suspicious ! \n\n");
+   } else {
+      printf("\n-- Factorization is CORRECT ! \n\n");
+   }
+
+   return info_factorization;
+}
+
+// Robust Check the factorization of the blocked matrix L. The original
+// matrix is regenerated tile by tile, so no linear copies are needed
+static int check_factorization(const int n, const int nt, const uint64_t seed, type_t *L)
+{
+#ifdef VERBOSE
+   printf ("Checking result ...\n");
+#endif
+
+   type_t *Rsum = (type_t *)calloc(n, sizeof(type_t)); // row sums of |L*L'-A|
+   type_t *Asum = (type_t *)calloc(n, sizeof(type_t)); // row sums of |A|
+   type_t *Atile = (type_t *)malloc(ts*ts*sizeof(type_t));
+   type_t *Rtile = (type_t *)malloc(ts*ts*sizeof(type_t));
+   type_t *Ldiag = (type_t *)malloc(ts*ts*sizeof(type_t));
+   assert(Rsum != NULL && Asum != NULL && Atile != NULL && Rtile != NULL && Ldiag != NULL);
+
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         /* Compute the Residual tile L(i,:)*L(j,:)' - A(i,j) */
+         gen_tile(n, seed, i, j, Atile);
+         for (int e = 0; e < ts*ts; e++) {
+            Rtile[e] = -Atile[e];
+         }
+         for (int k = 0; k <= j; k++) {
+            const type_t *Lik = L + TILE_IDX(i, k)*ts*ts;
+            const type_t *Ljk = L + TILE_IDX(j, k)*ts*ts;
+            if (k == j) {
+               copy_lower_tile(Ljk, Ldiag);
+               Ljk = Ldiag;
+               Lik = k == i ? Ldiag : Lik;
+            }
+            gemm(CBLAS_MAT_ORDER, CBLAS_NT, CBLAS_T,
+               ts, ts, ts, 1.0, Lik, ts, Ljk, ts, 1.0, Rtile, ts);
+         }
+
+         /* Accumulate the infinity norms, the upper tile (j,i) is the transposed one */
+         for (int c = 0; c < ts; c++) {
+            for (int r = 0; r < ts; r++) {
+               Rsum[i*ts + r] += fabs(Rtile[c*ts + r]);
+               Asum[i*ts + r] += fabs(Atile[c*ts + r]);
+               if (i != j) {
+                  Rsum[j*ts + c] += fabs(Rtile[c*ts + r]);
+                  Asum[j*ts + c] += fabs(Atile[c*ts + r]);
+               }
+            }
+         }
+      }
+   }
+
+   type_t Rnorm = 0, Anorm = 0;
+   for (int r = 0; r < n; r++) {
+      Rnorm = Rsum[r] > Rnorm ? Rsum[r] : Rnorm;
+      Anorm = Asum[r] > Anorm ? Asum[r] : Anorm;
+   }
+
+   const int info_factorization = check_result(n, Rnorm, Anorm);
+
+   free(Ldiag);
+   free(Rtile);
+   free(Atile);
+   free(Asum);
+   free(Rsum);
+
+   return info_factorization;
+}
+
+#pragma oss task in([ts*ts]A, [ts*nrhs]X) inout([ts*nrhs]Y)
+void check_gemm(const int nrhs, const int trans, const int diag,
+   const type_t *A, const type_t *X, type_t *Y)
+{
+   if (diag) {
+      // Only the lower triangle of diagonal tiles belongs to L
+      type_t *T = (type_t *)malloc(ts*nrhs*sizeof(type_t));
+      memcpy(T, X, ts*nrhs*sizeof(type_t));
+      trmm(CBLAS_MAT_ORDER, CBLAS_LF, CBLAS_LO, trans ? CBLAS_T : CBLAS_NT, CBLAS_NU,
+         ts, nrhs, 1.0, A, ts, T, ts);
+      for (int e = 0; e < ts*nrhs; e++) {
+         Y[e] += T[e];
+      }
+      free(T);
+   } else {
+      gemm(CBLAS_MAT_ORDER, trans ? CBLAS_T : CBLAS_NT, CBLAS_NT,
+         ts, nrhs, ts, 1.0, A, ts, X, ts, 1.0, Y, ts);
+   }
+}
+
+// Computes Y(i) = A(i,:)*X and the row sums of |A(i,:)|, regenerating the tiles of A
+#pragma oss task in([n*nrhs]X) out([ts*nrhs]Y, [ts]Asum)
+void check_gen_gemm(const int n, const int nt, const uint64_t seed, const int i,
+   const int nrhs, const type_t *X, type_t *Y, type_t *Asum)
+{
+   type_t *Atile = (type_t *)malloc(ts*ts*sizeof(type_t));
+
+   memset(Y, 0, ts*nrhs*sizeof(type_t));
+   memset(Asum, 0, ts*sizeof(type_t));
+   for (int j = 0; j < nt; j++) {
+      // Only the lower tiles are generated, A(i,j) = A(j,i)' above the diagonal
+      gen_tile(n, seed, j > i ? j : i, j > i ? i : j, Atile);
+      gemm(CBLAS_MAT_ORDER, j > i ? CBLAS_T : CBLAS_NT, CBLAS_NT,
+         ts, nrhs, ts, 1.0, Atile, ts, X + j*ts*nrhs, ts, 1.0, Y, ts);
+      for (int c = 0; c < ts; c++) {
+         for (int r = 0; r < ts; r++) {
+            Asum[j > i ? c : r] += fabs(Atile[c*ts + r]);
+         }
+      }
+   }
+
+   free(Atile);
+}
+
+// Randomized check of the factorization of the blocked matrix L. The rows of
+// A-L*L' are estimated with CHECK_PROBES random sign vectors x, as E[(Rx)_r^2]
+// is the squared 2-norm of row r, and bound ||R||_oo with sqrt(n) times the
+// largest row 2-norm. Only needs O(n^2) operations and O(n) extra memory.
+// With an out-of-core store st, L is only a buffer for a row of tiles and the
+// factor is read from st, a row at a time. With the tile pointers T of a
+// tile-sparse factor, L is not used and the zero tiles are skipped.
+static int check_factorization_probes(const int n, const int nt, const uint64_t seed, type_t *L,
+   ooc_store_t *st, type_t * const *T)
+{
+#ifdef VERBOSE
+   printf ("Checking result (%d random probes) ...\n", CHECK_PROBES);
+#endif
+
+   const int nrhs = CHECK_PROBES;
+   int ISEED[4] = {1,2,3,5};
+   int intTWO = 2;
+   const int len = n*nrhs;
+   // Probe-like vectors, stored by row tiles of ts x nrhs elements
+   type_t *X = (type_t *)malloc(n*nrhs*sizeof(type_t));
+   type_t *Y = (type_t *)malloc(n*nrhs*sizeof(type_t));
+   type_t *Z = (type_t *)calloc(n*nrhs, sizeof(type_t));
+   type_t *W = (type_t *)calloc(n*nrhs, sizeof(type_t));
+   type_t *Asum = (type_t *)malloc(n*sizeof(type_t));
+   assert(X != NULL && Y != NULL && Z != NULL && W != NULL && Asum != NULL);
+
+   larnv(&intTWO, &ISEED[0], &len, X);
+   for (int e = 0; e < n*nrhs; e++) {
+      X[e] = X[e] < 0 ? -1 : 1;
+   }
+
+   // Y = A*X
+   for (int i = 0; i < nt; i++) {
+      check_gen_gemm(n, nt, seed, i, nrhs, X, Y + i*ts*nrhs, Asum + i*ts);
+   }
+
+   // Z = L'*X
+   for (int i = 0; i < nt; i++) {
+      const type_t *Li = st != NULL ? L : L + TILE_IDX(i, 0)*ts*ts;
+      if (st != NULL) {
+         #pragma oss taskwait
+         ooc_read(st, i, 0, i + 1, L);
+      }
+      for (int j = 0; j <= i; j++) {
+         const type_t *Lij = T != NULL ? T[TILE_IDX(i, j)] : Li + j*ts*ts;
+         if (Lij == NULL) continue;
+         check_gemm(nrhs, 1, i == j, Lij, X + i*ts*nrhs, Z + j*ts*nrhs);
+      }
+   }
+   #pragma oss taskwait
+
+   // W = L*Z
+   for (int i = 0; i < nt; i++) {
+      const type_t *Li = st != NULL ? L : L + TILE_IDX(i, 0)*ts*ts;
+      if (st != NULL) {
+         #pragma oss taskwait
+         ooc_read(st, i, 0, i + 1, L);
+      }
+      for (int j = 0; j <= i; j++) {
+         const type_t *Lij = T != NULL ? T[TILE_IDX(i, j)] : Li + j*ts*ts;
+         if (Lij == NULL) continue;
+         check_gemm(nrhs, 0, i == j, Lij, Z + j*ts*nrhs, W + i*ts*nrhs);
+      }
+   }
+   #pragma oss taskwait
+
+   type_t Rnorm = 0, Anorm = 0;
+   for (int r = 0; r < n; r++) {
+      const int i = r/ts, ri = r%ts;
+      type_t sq = 0;
+      for (int q = 0; q < nrhs; q++) {
+         const type_t d = Y[(i*nrhs + q)*ts + ri] - W[(i*nrhs + q)*ts + ri];
+         sq += d*d;
+      }
+      sq = sqrt(n*sq/nrhs);
+      Rnorm = sq > Rnorm ? sq : Rnorm;
+      Anorm = Asum[r] > Anorm ? Asum[r] : Anorm;
+   }
+
+   const int info_factorization = check_result(n, Rnorm, Anorm);
+
+   free(Asum);
+   free(W);
+   free(Z);
+   free(Y);
+   free(X);
+
+   return info_factorization;
+}
+
+// Converts the transposed right-hand side tiles of cholesky_solve_blocked to
+// row tiles of ts x (nq*ts) elements
+static void rhs_to_row_tiles(const int nt, const int nq, const type_t *X, type_t *R)
+{
+   for (int q = 0; q < nq; q++) {
+      for (int i = 0; i < nt; i++) {
+         const type_t *T = X + (q*nt + i)*ts*ts;
+         type_t *Ri = R + i*ts*nq*ts;
+         for (int r = 0; r < ts; r++) {
+            for (int c = 0; c < ts; c++) {
+               Ri[(q*ts + c)*ts + r] = T[r*ts + c];
+            }
+         }
+      }
+   }
+}
+
+// Checks the solution X of A*X = B through ||A*X-B||_oo/(||A||_oo.||X||_oo.N.eps),
+// both given as transposed right-hand side tiles
+static int check_solve(const int n, const int nt, const int nq, const uint64_t seed,
+   const type_t *X, const type_t *B)
+{
+   const int nrhs = nq*ts;
+   type_t const b = 2.0;
+#ifdef USE_DOUBLE
+   const int t = 53;
+#else
+   const int t = 24;
+#endif
+   type_t const eps = pow_di( b, -t );
+   type_t *Xr = (type_t *)malloc(n*nrhs*sizeof(type_t));
+   type_t *Br = (type_t *)malloc(n*nrhs*sizeof(type_t));
+   type_t *Y = (type_t *)malloc(n*nrhs*sizeof(type_t));
+   type_t *Asum = (type_t *)malloc(n*sizeof(type_t));
+   assert(Xr != NULL && Br != NULL && Y != NULL && Asum != NULL);
+
+   rhs_to_row_tiles(nt, nq, X, Xr);
+   rhs_to_row_tiles(nt, nq, B, Br);
+   for (int i = 0; i < nt; i++) {
+      check_gen_gemm(n, nt, seed, i, nrhs, Xr, Y + i*ts*nrhs, Asum + i*ts);
+   }
+   #pragma oss taskwait
+
+   type_t Rnorm = 0, Anorm = 0, Xnorm = 0;
+   for (int r = 0; r < n; r++) {
+      const int i = r/ts, ri = r%ts;
+      type_t rsum = 0, xsum = 0;
+      for (int c = 0; c < nrhs; c++) {
+         rsum += fabs(Y[(i*nrhs + c)*ts + ri] - Br[(i*nrhs + c)*ts + ri]);
+         xsum += fabs(Xr[(i*nrhs + c)*ts + ri]);
+      }
+      Rnorm = rsum > Rnorm ? rsum : Rnorm;
+      Xnorm = xsum > Xnorm ? xsum : Xnorm;
+      Anorm = Asum[r] > Anorm ? Asum[r] : Anorm;
+   }
+
+   printf("==================================================\n");
+   printf("Checking the solution of A*X = B\n");
+#ifdef VERBOSE
+   printf("-- ||A*X-B||_oo/(||A||_oo.||X||_oo.N.eps) = %e \n", Rnorm/(Anorm*Xnorm*n*eps));
+#endif
+
+   const int info_solve = isnan(Rnorm/(Anorm*Xnorm*n*eps)) ||
+      isinf(Rnorm/(Anorm*Xnorm*n*eps)) || (Rnorm/(Anorm*Xnorm*n*eps) > 60.0);
+
+   if ( info_solve ){
+      fprintf(stderr, "\n-- Solution is suspicious ! \n\n");
+   } else {
+      printf("\n-- Solution is CORRECT ! \n\n");
+   }
+
+   free(Asum);
+   free(Y);
+   free(Br);
+   free(Xr);
+
+   return info_solve;
+}
+
+// ||A||_oo of the symmetric n x n matrix whose lower triangle is stored in A
+static type_t sym_norm_inf(const int n, const type_t *A, type_t *rowsum)
+{
+   type_t norm = 0;
+
+   memset(rowsum, 0, n*sizeof(type_t));
+   for (int c = 0; c < n; c++) {
+      for (int r = c; r < n; r++) {
+         rowsum[r] += fabs(A[c*n + r]);
+         if (r > c) rowsum[c] += fabs(A[c*n + r]);
+      }
+   }
+   for (int r = 0; r < n; r++) {
+      norm = rowsum[r] > norm ? rowsum[r] : norm;
+   }
+
+   return norm;
+}
+
+// Exact check of every matrix of a batch factorized by cholesky_batch, the
+// verdict is given for the matrix with the largest relative residual
+static int check_batch(const int n, const int nb, const uint64_t seed, const type_t *L)
+{
+#ifdef VERBOSE
+   printf ("Checking result of %d matrices ...\n", nb);
+#endif
+
+   type_t *Lb = (type_t *)malloc(n*n*sizeof(type_t));
+   type_t *Ab = (type_t *)malloc(n*n*sizeof(type_t));
+   type_t *rowsum = (type_t *)malloc(n*sizeof(type_t));
+   assert(Lb != NULL && Ab != NULL && rowsum != NULL);
+   type_t Rworst = 0, Aworst = 1;
+
+   for (int b = 0; b < nb; b++) {
+      // Linear copy of the lower triangle of the factor
+      memset(Lb, 0, n*n*sizeof(type_t));
+      if (n < ts) {
+         const int pm = ts/n;
+         const type_t *Lm = L + (b/pm)*ts*ts + (b%pm)*(n*ts + n);
+         for (int c = 0; c < n; c++) {
+            for (int r = c; r < n; r++) {
+               Lb[c*n + r] = Lm[c*ts + r];
+            }
+         }
+      } else {
+         const int nt = n/ts;
+         const type_t *Lm = L + b*NUM_TILES(nt)*ts*ts;
+         for (int i = 0; i < nt; i++) {
+            for (int j = 0; j <= i; j++) {
+               for (int c = 0; c < ts; c++) {
+                  for (int r = i == j ? c : 0; r < ts; r++) {
+                     Lb[(j*ts + c)*n + i*ts + r] = Lm[TILE_IDX(i, j)*ts*ts + c*ts + r];
+                  }
+               }
+            }
+         }
+      }
+
+      gen_matrix_linear(n, gen_jump(seed, (uint64_t)b*n*n), n, Ab);
+      const type_t Anorm = sym_norm_inf(n, Ab, rowsum);
+      // A = L*L' - A
+      syrk(CBLAS_MAT_ORDER, CBLAS_LO, CBLAS_NT, n, n, 1.0, Lb, n, -1.0, Ab, n);
+      const type_t Rnorm = sym_norm_inf(n, Ab, rowsum);
+      if (!(Rnorm*Aworst <= Rworst*Anorm)) {
+         Rworst = Rnorm;
+         Aworst = Anorm;
+      }
+   }
+
+   const int info_factorization = check_result(n, Rworst, Aworst);
+
+   free(rowsum);
+   free(Ab);
+   free(Lb);
+
+   return info_factorization;
+}
+
+#ifdef DYNAMIC_TS
+// Returns the tile size stored by the tuning mode for matrix size n, or 0
+static int read_tuned_ts(const int n)
+{
+   FILE *f = fopen(TUNE_FILE, "r");
+   int tn, tts, found = 0;
+
+   if (f == NULL) return 0;
+   while (fscanf(f, "%d %d%*[^\n]", &tn, &tts) == 2) {
+      //NOTE: Later entries override the older ones
+      if (tn == n) found = tts;
+   }
+   fclose(f);
+
+   return found;
+}
+
+// Factorizes the n x n matrix once with every power of two tile size that
+// divides n, leaving at least 2x2 tiles, and stores the fastest one in TUNE_FILE
+static int tune_tile_size(const int n, const int la, const uint64_t seed)
+{
+   int best = 0;
+   double tBest = 0;
+
+   printf( "==================== TUNING ====================== \n" );
+   for (int cand = 16; cand <= n/2 && cand <= 2048; cand *= 2) {
+      if (n % cand != 0) continue;
+
+      ts = cand;
+      const int nt = n / ts;
+      type_t *A = malloc(ts*ts*sizeof(type_t)*NUM_TILES(nt));
+      assert(A != NULL);
+      gen_matrix_blocked(n, nt, seed, A);
+      #pragma oss taskwait
+
+      const double tIni = wall_time();
+      cholesky_blocked(nt, la, A);
+      #pragma oss taskwait
+      const double t = wall_time() - tIni;
+      free(A);
+
+      printf( "  Block size %4d:       %f secs, %f GFLOPS\n", cand, t, ((double)n*n*n/3.0)/t/1e9 );
+      if (best == 0 || t < tBest) {
+         best = cand;
+         tBest = t;
+      }
+   }
+
+   FILE *f = fopen(TUNE_FILE, "a");
+   if (f != NULL) {
+      fprintf(f, "%d %d %f\n", n, best, tBest);
+      fclose(f);
+   } else {
+      fprintf( stderr, "WARNING:\tCannot write '%s' file\n", TUNE_FILE );
+   }
+   printf( "  Best block size:       %d\n", best );
+
+   return best;
+}
+#endif
+
+static int cmp_double(const void *a, const void *b)
+{
+   const double x = *(const double *)a, y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+// Computes the minimum, median and standard deviation of the len samples in v
+static void sample_stats(const int len, const double *v, double *min, double *med, double *std)
+{
+   double *sorted = (double *)malloc(len*sizeof(double));
+   double mean = 0, var = 0;
+
+   memcpy(sorted, v, len*sizeof(double));
+   qsort(sorted, len, sizeof(double), cmp_double);
+   for (int r = 0; r < len; r++) {
+      mean += v[r]/len;
+   }
+   for (int r = 0; r < len; r++) {
+      var += (v[r] - mean)*(v[r] - mean)/len;
+   }
+   *min = sorted[0];
+   *med = len % 2 ? sorted[len/2] : (sorted[len/2 - 1] + sorted[len/2])/2;
+   *std = sqrt(var);
+
+   free(sorted);
+}
+
+#ifdef KERNEL_STATS
+#ifdef POTRF_SMP
+#  define KS_POTRF_SMP 1
+#else
+#  define KS_POTRF_SMP 0
+#endif
+#ifdef TRSM_SMP
+#  define KS_TRSM_SMP 1
+#else
+#  define KS_TRSM_SMP 0
+#endif
+#ifdef OPENBLAS_IMPL
+#  define KS_UPDATE_SMP 1
+#else
+#  define KS_UPDATE_SMP 0
+#endif
+
+// Kernel calls of a factorization of nb matrices of nt x nt tiles (or of
+// nb packed tiles when nt is 0) followed by ns solves of nq right-hand side tiles
+static void kernel_calls(const uint64_t nt, const uint64_t nb, const uint64_t nq, const uint64_t ns,
+   uint64_t calls[KS_NUM])
+{
+   calls[KS_POTRF] = nt == 0 ? nb : nb*nt;
+   calls[KS_TRSM]  = nb*nt*(nt - (nt > 0))/2 + ns*nq*nt;
+   calls[KS_SYRK]  = nb*nt*(nt - (nt > 0))/2;
+   calls[KS_GEMM]  = nt < 2 ? 0 : nb*nt*(nt - 1)*(nt - 2)/6 + ns*nq*nt*(nt - 1)/2;
+}
+#endif
+
+// Nonzero tiles of a tile-sparse matrix: the ones at most band tiles away from
+// the diagonal, plus pct percent of the other ones, chosen by a hash of their
+// position. The diagonal ones are always nonzero.
+static void sparse_pattern(const int nt, const int band, const int pct, const uint64_t seed, char *nz)
+{
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         uint64_t h = seed ^ ((uint64_t)i << 32 | (uint64_t)j);
+         h = (h ^ (h >> 30))*UINT64_C(0xbf58476d1ce4e5b9);
+         h = (h ^ (h >> 27))*UINT64_C(0x94d049bb133111eb);
+         h ^= h >> 31;
+         nz[TILE_IDX(i, j)] = i - j <= band || (int)(h % 100) < pct;
+      }
+   }
+}
+
+// Symbolic factorization of the tile-sparse matrix with nonzero tiles nz. Adds
+// the tiles filled in by cholesky_sparse to nz, counts its kernel calls and
+// returns the number of nonzero tiles of L
+static int sparse_fill(const int nt, char *nz, uint64_t calls[KS_NUM])
+{
+   int nnz = 0;
+
+   memset(calls, 0, KS_NUM*sizeof(uint64_t));
+   for (int k = 0; k < nt; k++) {
+      calls[KS_POTRF]++;
+      for (int j = k + 1; j < nt; j++) {
+         if (!nz[TILE_IDX(j, k)]) continue;
+         calls[KS_TRSM]++;
+         calls[KS_SYRK]++;
+         for (int i = j + 1; i < nt; i++) {
+            if (!nz[TILE_IDX(i, k)]) continue;
+            nz[TILE_IDX(i, j)] = 1;
+            calls[KS_GEMM]++;
+         }
+      }
+   }
+   for (int t = 0; t < NUM_TILES(nt); t++) {
+      nnz += nz[t];
+   }
+
+   return nnz;
+}
+
+int main(int argc, char* argv[])
+{
+   char *result[3] = {"n/a","sucessful","UNSUCCESSFUL"};
+   int overlap = 0; // overlap the matrix generation with the factorization?
+   int reps = 1;    // number of measured factorizations
+   int la = 1;      // lookahead depth of cholesky_blocked
+   int nrhs = 0;    // right-hand sides solved after the factorization
+   int mixed = 0;   // refine the solution in double precision?
+   int iters = 0;   // refinement steps of the last repetition, -1 if it fell back to double
+   int batch = 0;   // independent matrices factorized at once, 0 for a single matrix
+   int hs = 0;      // tiles per super-tile side of the two-level factorization, 0 for one level
+   int wback = 0;   // write the factor back to the linear matrix as its tiles are final?
+   const char *ooc = NULL; // file of the out-of-core tile store, NULL to keep the matrix in memory
+   int cache_mb = 1024;    // tile cache of the out-of-core mode, in MB
+   const char *ifile = NULL; // matrix file to factorize instead of the generated matrix
+   const char *sfile = NULL; // matrix file to save the input matrix to
+   const char *ffile = NULL; // matrix file where the matrix is factorized in place
+   int band = -1;  // tiles away from the diagonal that are nonzero in a tile-sparse matrix, -1 for a dense one
+   int pct = 0;    // percentage of the other tiles that are nonzero
+   int urank = 0;  // rank of the update of the factor after the measured factorizations, 0 for none
+   int down = 0;   // downdate the factor instead?
+#ifdef USE_DMA_MEM
+   int akind = TA_PINNED;  // allocator of the blocked matrix
+#else
+   int akind = TA_ALIGNED; // allocator of the blocked matrix
+#endif
+#ifdef DYNAMIC_TS
+   int tune = 0;    // sweep the tile sizes before the run?
+#endif
+   int opt;
+
+   while ( (opt = getopt(argc, argv, "or:l:s:mB:H:wa:O:M:i:S:f:z:u:d:b:t")) != -1 ) {
+      switch (opt) {
+         case 'o':
+            overlap = 1;
+            break;
+         case 'r':
+            reps = atoi(optarg);
+            break;
+         case 'l':
+            la = atoi(optarg);
+            break;
+         case 's':
+            nrhs = atoi(optarg);
+            break;
+         case 'm':
+            mixed = 1;
+            break;
+         case 'B':
+            batch = atoi(optarg);
+            break;
+         case 'H':
+            hs = atoi(optarg);
+            break;
+         case 'w':
+            wback = 1;
+            break;
+         case 'a':
+            akind = tile_alloc_kind(optarg);
+            if (akind < 0) {
+               fprintf( stderr, "ERROR:\tUnknown allocator '%s', use one of malloc, aligned, huge, hugetlb, interleave, pinned\n", optarg );
+               return 1;
+            }
+            break;
+         case 'O':
+            ooc = optarg;
+            break;
+         case 'M':
+            cache_mb = atoi(optarg);
+            break;
+         case 'i':
+            ifile = optarg;
+            break;
+         case 'S':
+            sfile = optarg;
+            break;
+         case 'f':
+            ffile = optarg;
+            break;
+         case 'z':
+            if (sscanf(optarg, "%d:%d", &band, &pct) < 1 || band < 0 || pct < 0 || pct > 100) {
+               fprintf( stderr, "ERROR:\tThe tile sparsity must be <band>[:<percent>]\n" );
+               return 1;
+            }
+            break;
+         case 'u':
+         case 'd':
+            urank = atoi(optarg);
+            down = opt == 'd';
+            break;
+#ifdef DYNAMIC_TS
+         case 'b':
+            ts = strcmp(optarg, "auto") == 0 ? -1 : atoi(optarg);
+            break;
+         case 't':
+            tune = 1;
+            break;
+#endif
+         default:
+            fprintf( stderr, "USAGE:\t%s [-o] [-r <reps>] [-l <lookahead>] [-s <nrhs>] [-m] [-B <batch>] [-H <super tile>] [-w] [-a <allocator>] [-O <file> [-M <cache MB>]] [-i <file>] [-S <file>] [-f <file>] [-z <band>[:<percent>]] [-u|-d <rank>] [-b <block size>|auto] [-t] <matrix size> [<check>]\n", argv[0] );
+            return 1;
+      }
+   }
+   if ( argc - optind < 1 ) {
+      fprintf( stderr, "USAGE:\t%s [-o] [-r <reps>] [-l <lookahead>] [-s <nrhs>] [-m] [-B <batch>] [-H <super tile>] [-w] [-a <allocator>] [-O <file> [-M <cache MB>]] [-i <file>] [-S <file>] [-f <file>] [-z <band>[:<percent>]] [-u|-d <rank>] [-b <block size>|auto] [-t] <matrix size> [<check>]\n", argv[0] );
+      return 1;
+   }
+   argc -= optind - 1;
+   argv += optind - 1;
+   const int  n = atoi(argv[1]); // matrix size
+   int check    = argc > 2 ? atoi(argv[2]) : 1; // check result?
+   int ISEED[4] = {0,0,0,1};
+   const uint64_t seed = gen_seed(ISEED);
+   // Input matrix file, its tiles replace the generated ones
+   tilefile_header_t ihdr;
+   type_t *Asrc = NULL;
+   if ( ifile != NULL ) {
+      Asrc = tilefile_map(ifile, 0, &ihdr);
+      if ( Asrc == NULL ) exit( -1 );
+      if ( ihdr.n != (uint64_t)n || ihdr.elem_size != sizeof(type_t) ) {
+         fprintf( stderr, "ERROR:\t'%s' holds a %llu x %llu matrix of %s\n", ifile,
+            (unsigned long long)ihdr.n, (unsigned long long)ihdr.n, ihdr.elem_size == 8 ? "double" : "float" );
+         exit( -1 );
+      }
+#ifdef DYNAMIC_TS
+      ts = ihdr.ts;
+      tune = 0;
+#endif
+   }
+#ifdef DYNAMIC_TS
+   if ( tune ) {
+      ts = tune_tile_size(n, la, seed);
+   } else if ( ts < 0 ) {
+      ts = read_tuned_ts(n);
+      if ( ts == 0 ) {
+         fprintf( stderr, "WARNING:\tNo tuned block size for %d in '%s', using %d\n", n, TUNE_FILE, BLOCK_SIZE );
+         ts = BLOCK_SIZE;
+      }
+   }
+   if ( ts <= 0 ) {
+      fprintf( stderr, "ERROR:\t<block size> must be positive\n" );
+      exit( -1 );
+   }
+#endif
+   if ( ifile != NULL && ihdr.ts != (uint32_t)ts ) {
+      fprintf( stderr, "ERROR:\t'%s' has %dx%d tiles, the accelerators are built for %dx%d\n", ifile, ihdr.ts, ihdr.ts, ts, ts );
+      exit( -1 );
+   }
+   const int nt = n / ts; // number of tiles
+   if ( batch > 0 && n < ts ) {
+      if ( n <= 0 || ts % n != 0 ) {
+         fprintf( stderr, "ERROR:\t<matrix size> smaller than <block size> must divide it\n" );
+         exit( -1 );
+      }
+   } else if ( n % ts != 0 ) {
+      fprintf( stderr, "ERROR:\t<matrix size> is not multiple of <block size>\n" );
+      exit( -1 );
+   }
+   if ( batch < 0 ) {
+      fprintf( stderr, "ERROR:\t<batch> cannot be negative\n" );
+      exit( -1 );
+   }
+   if ( batch > 0 && (nrhs > 0 || mixed) ) {
+      fprintf( stderr, "ERROR:\tThe batched mode does not solve right-hand sides\n" );
+      exit( -1 );
+   }
+   if ( la < 0 ) {
+      fprintf( stderr, "ERROR:\t<lookahead> cannot be negative\n" );
+      exit( -1 );
+   }
+   if ( hs < 0 ) {
+      fprintf( stderr, "ERROR:\t<super tile> cannot be negative\n" );
+      exit( -1 );
+   }
+   if ( batch > 0 && hs > 0 ) {
+      fprintf( stderr, "ERROR:\tThe batched mode does not use super-tiles\n" );
+      exit( -1 );
+   }
+   if ( batch > 0 && wback ) {
+      fprintf( stderr, "ERROR:\tThe batched mode is not written back to a linear matrix\n" );
+      exit( -1 );
+   }
+   if ( reps < 1 ) {
+      fprintf( stderr, "ERROR:\t<reps> must be at least 1\n" );
+      exit( -1 );
+   }
+   if ( nrhs < 0 ) {
+      fprintf( stderr, "ERROR:\t<nrhs> cannot be negative\n" );
+      exit( -1 );
+   }
+   if ( ooc != NULL && (batch > 0 || nrhs > 0 || mixed || hs > 0 || wback) ) {
+      fprintf( stderr, "ERROR:\tThe out-of-core mode does not support -B, -s, -m, -H or -w\n" );
+      exit( -1 );
+   }
+   if ( batch > 0 && (ifile != NULL || sfile != NULL || ffile != NULL) ) {
+      fprintf( stderr, "ERROR:\tThe batched mode does not use matrix files\n" );
+      exit( -1 );
+   }
+   if ( ooc != NULL && (sfile != NULL || ffile != NULL) ) {
+      fprintf( stderr, "ERROR:\tThe out-of-core mode keeps the factor in its own file\n" );
+      exit( -1 );
+   }
+   if ( ifile != NULL && ffile != NULL && strcmp(ifile, ffile) == 0 ) {
+      fprintf( stderr, "ERROR:\tThe input matrix file cannot be the factor file\n" );
+      exit( -1 );
+   }
+   if ( band >= 0 && (batch > 0 || nrhs > 0 || mixed || hs > 0 || wback || ooc != NULL ||
+      ifile != NULL || sfile != NULL || ffile != NULL) ) {
+      fprintf( stderr, "ERROR:\tTile-sparse matrices do not support -B, -s, -m, -H, -w, -O, -i, -S or -f\n" );
+      exit( -1 );
+   }
+   if ( urank < 0 ) {
+      fprintf( stderr, "ERROR:\t<rank> cannot be negative\n" );
+      exit( -1 );
+   }
+   if ( urank > 0 && (batch > 0 || nrhs > 0 || mixed || wback || ooc != NULL || band >= 0) ) {
+      fprintf( stderr, "ERROR:\tThe low-rank update does not support -B, -s, -m, -w, -O or -z\n" );
+      exit( -1 );
+   }
+   if ( mixed && nrhs == 0 ) {
+      nrhs = 1;
+   }
+   const int nq = (nrhs + ts - 1) / ts; // number of right-hand side tiles per block row
+   // Tile sparsity: nonzero tiles of A, and of L after the fill-in, which are the only allocated ones
+   char *anz = NULL, *lnz = NULL;
+   int nnz = NUM_TILES(nt);
+   uint64_t scalls[KS_NUM]; // kernel calls of the tile-sparse factorization
+   if ( band >= 0 ) {
+      anz = (char *)malloc(NUM_TILES(nt));
+      lnz = (char *)malloc(NUM_TILES(nt));
+      assert(anz != NULL && lnz != NULL);
+      sparse_pattern(nt, band, pct, seed, anz);
+      memcpy(lnz, anz, NUM_TILES(nt));
+      nnz = sparse_fill(nt, lnz, scalls);
+      gen_set_mask(anz);
+      //NOTE: The exact check needs the whole factor in memory
+      if ( check == 1 ) check = 3;
+   }
+   // Factorization flops, the real ones of the nonzero tiles for tile-sparse matrices
+   const double flops = band >= 0 ? (double)ts*ts*ts*(scalls[KS_POTRF]/3.0 + scalls[KS_TRSM] +
+      scalls[KS_SYRK] + 2.0*scalls[KS_GEMM]) : (double)n*n*n/3.0;
+   const int ntiles = batch > 0 ? BATCH_TILES(n, batch) : nnz; // number of stored tiles
+   const size_t s = ts * ts * sizeof(type_t);
+   // The out-of-core mode only keeps the tile cache in memory
+   const int ctiles = ooc != NULL ? ((size_t)cache_mb << 20)/s : ntiles;
+   if ( ooc != NULL && ctiles/3 < nt ) {
+      fprintf( stderr, "ERROR:\tThe out-of-core cache needs at least %zu MB for this matrix\n",
+         ((3*(size_t)nt*s) >> 20) + 1 );
+      exit( -1 );
+   }
+   if ( ooc != NULL && check == 1 ) {
+      //NOTE: The exact check needs the whole factor in memory
+      check = 3;
+   }
+
+   // Allocate matrix
+   type_t * const matrix = ooc != NULL || band >= 0 ? NULL : (type_t *) malloc(n * n * sizeof(type_t));
+   assert(ooc != NULL || band >= 0 || matrix != NULL);
+
+   // Allocate blocked matrix (lower triangle only), or the out-of-core tile cache.
+   // It can also be a mapping of the factor file or, if it has the same layout, of the input file
+   tilefile_header_t ahdr;
+   int amap = 0; // 1 if Ab maps the input file (copy-on-write), 2 if it maps the factor file
+   type_t *Ab;
+   if ( ffile != NULL ) {
+      Ab = tilefile_create(ffile, n, TILEFILE_FACTOR, ifile != NULL ? ihdr.seed : seed, &ahdr);
+      amap = 2;
+   } else if ( ifile != NULL && ooc == NULL && (ihdr.flags & TILEFILE_LOWER) ) {
+      Ab = tilefile_map(ifile, 1, &ahdr);
+      amap = 1;
+   } else {
+      Ab = tile_alloc(&akind, s*ctiles);
+   }
+   assert(Ab != NULL);
+   if ( ifile != NULL ) {
+      gen_set_source(Asrc, nt, ihdr.flags & TILEFILE_LOWER);
+   }
+   // Tile pointers of a tile-sparse matrix, its nonzero tiles are stored in the same order as the blocked matrix
+   type_t **At = NULL;
+   if ( band >= 0 ) {
+      At = (type_t **)malloc(NUM_TILES(nt)*sizeof(type_t *));
+      assert(At != NULL);
+      for (int t = 0, k = 0; t < NUM_TILES(nt); t++) {
+         At[t] = lnz[t] ? Ab + (k++)*ts*ts : NULL;
+      }
+   }
+   ooc_store_t store;
+
+   double tIniStart = wall_time();
+
+   // Init matrix
+#ifdef VERBOSE
+   printf("Initializing matrix with random values ...\n");
+#endif
+   if ( ooc != NULL ) {
+      if ( ooc_open(&store, ooc, nt) != 0 ) exit( -1 );
+      ooc_gen_matrix(n, nt, seed, &store);
+   } else if ( batch > 0 ) {
+      gen_batch(n, batch, seed, Ab);
+   } else if ( band >= 0 ) {
+      gen_matrix_tiles(n, nt, seed, At);
+   } else if ( amap != 1 ) {
+      gen_matrix_blocked(n, nt, seed, Ab);
+   }
+   if ( sfile != NULL ) {
+      tilefile_header_t shdr;
+      type_t * const As = tilefile_create(sfile, n, 0, ifile != NULL ? ihdr.seed : seed, &shdr);
+      if ( As == NULL ) exit( -1 );
+      copy_tiles(ntiles, Ab, As);
+      #pragma oss taskwait
+      tilefile_unmap(&shdr, As, 1);
+   }
+   if ( !overlap ) {
+      #pragma oss taskwait
+   }
+
+   // Right-hand sides, in the transposed tiles of cholesky_solve_blocked
+   type_t *Xb = NULL, *Bb = NULL;
+   // or in double precision row tiles of ts x nrhs elements for the mixed precision solve
+   double *Xd = NULL, *Bd = NULL;
+   if ( mixed ) {
+      int RSEED[4] = {0,0,1,1};
+      int intTWO = 2;
+      const int len = n*nrhs;
+      Xd = malloc(n*nrhs*sizeof(double));
+      Bd = malloc(n*nrhs*sizeof(double));
+      assert(Xd != NULL && Bd != NULL);
+      larnv_d(&intTWO, &RSEED[0], &len, Bd);
+   } else if ( nrhs > 0 ) {
+      int RSEED[4] = {0,0,1,1};
+      int intTWO = 2;
+      const int len = nq*nt*ts*ts;
+      Xb = malloc(s*nq*nt);
+      Bb = malloc(s*nq*nt);
+      assert(Xb != NULL && Bb != NULL);
+      larnv(&intTWO, &RSEED[0], &len, Bb);
+      // Padding right-hand sides of the last tiles are zero
+      for (int i = 0; i < nt; i++) {
+         type_t *T = Bb + ((nq - 1)*nt + i)*ts*ts;
+         for (int r = 0; r < ts; r++) {
+            for (int c = nrhs - (nq - 1)*ts; c < ts; c++) {
+               T[r*ts + c] = 0;
+            }
+         }
+      }
+   }
+
+   const double tEndStart = wall_time();
+
+#ifdef VERBOSE
+   printf ("Executing ...\n");
+#endif
+
+   // Pristine copy of the input, restored before every factorization but the first one
+   type_t *Asnap = NULL;
+   if ( ooc == NULL && (reps > 1 || check == 2) ) {
+      Asnap = malloc(s*ntiles);
+      assert(Asnap != NULL);
+      copy_tiles(ntiles, Ab, Asnap);
+      //NOTE: The first measured run is timed from tEndWarm, so the copy must be done by then
+      #pragma oss taskwait
+   }
+
+   const double tIniWarm = wall_time();
+
+   //Warm up execution
+   if (check == 2) {
+       if (batch > 0) {
+          cholesky_batch(n, batch, la, Ab);
+       } else if (ooc != NULL) {
+          cholesky_ooc(nt, ctiles, Ab, &store);
+       } else if (band >= 0) {
+          cholesky_sparse(nt, At);
+       } else if (hs > 0) {
+          cholesky_hier(nt, hs, Ab);
+       } else {
+          cholesky_blocked(nt, la, Ab);
+       }
+       if (ooc != NULL) {
+          ooc_gen_matrix(n, nt, seed, &store);
+       } else {
+          copy_tiles(ntiles, Asnap, Ab);
+       }
+       #pragma oss taskwait
+   }
+
+   const double tEndWarm = wall_time();
+   double tIniExec = tEndWarm;
+   double tEndExec = tIniExec;
+#ifdef KERNEL_STATS
+   uint64_t kcalls[KS_NUM]; // kernel calls of one measured run
+   kernel_calls(batch > 0 && n < ts ? 0 : nt, batch > 0 ? (n < ts ? ntiles : batch) : 1, nq, mixed ? 2 : nrhs > 0, kcalls);
+   if (band >= 0) memcpy(kcalls, scalls, sizeof(kcalls));
+   for (int k = 0; k < KS_NUM; k++) {
+      kcalls[k] *= reps;
+   }
+   kstats_init(kcalls);
+#endif
+   double * const times = (double *)malloc(reps*sizeof(double));
+   double * const perfs = (double *)malloc(reps*sizeof(double));
+
+   //Performance execution
+   for (int r = 0; r < reps; r++) {
+      if (r > 0 && ooc != NULL) {
+         ooc_gen_matrix(n, nt, seed, &store);
+      } else if (r > 0) {
+         copy_tiles(ntiles, Asnap, Ab);
+      }
+      if (nrhs > 0 && !mixed) {
+         copy_tiles(nq*nt, Bb, Xb);
+      }
+      if (r > 0 || nrhs > 0) {
+         #pragma oss taskwait
+         tIniExec = wall_time();
+      }
+#ifdef KERNEL_STATS
+      kstats_start();
+#endif
+#ifdef COEXEC
+      coexec_start();
+#endif
+
+      if (batch > 0) {
+         cholesky_batch(n, batch, la, Ab);
+      } else if (ooc != NULL) {
+         cholesky_ooc(nt, ctiles, Ab, &store);
+      } else if (band >= 0) {
+         cholesky_sparse(nt, At);
+      } else if (hs > 0) {
+         cholesky_hier(nt, hs, Ab);
+      } else {
+         cholesky_blocked(nt, la, Ab);
+      }
+      if (wback && r == reps - 1) {
+         //NOTE: Each scatter task only waits for the last task that writes its
+         //      tile, so the finished panels are brought back from the device
+         //      and converted while the trailing matrix is still being updated
+         convert_to_linear(nt, n, Ab, (type_t (*)[n]) matrix);
+      }
+      if (mixed) {
+         iters = cholesky_refine(n, nt, seed, Ab, nrhs, Bd, Xd);
+         if (iters < 0) {
+            cholesky_solve_d(n, nt, seed, nrhs, Bd, Xd);
+         }
+      } else if (nrhs > 0) {
+         cholesky_solve_blocked(nt, nq, Ab, Xb);
+      }
+
+      #pragma oss taskwait
+      tEndExec = wall_time();
+#ifdef KERNEL_STATS
+      kstats_stop();
+#endif
+#ifdef COEXEC
+      coexec_stop();
+#endif
+      times[r] = tEndExec - tIniExec;
+      perfs[r] = batch > 0 ? (double)batch*n*n*n/3.0/times[r]/1e9 :
+         (flops + 2.0*n*n*nrhs)/times[r]/1e9;
+   }
+   free(Asnap);
+   // I/O of the last measured factorization, before the check reads the factor back
+   ooc_store_t ostats;
+   memset(&ostats, 0, sizeof(ostats));
+   if ( ooc != NULL ) ostats = store;
+
+#ifdef KERNEL_STATS
+   // FPGA kernels cannot be timed, they are only counted
+   kernel_calls(batch > 0 && n < ts ? 0 : nt, batch > 0 ? (n < ts ? ntiles : batch) : 1, nq,
+      mixed ? (iters < 0 ? REFINE_ITERMAX : iters) + 1 : nrhs > 0, kcalls);
+   if (band >= 0) memcpy(kcalls, scalls, sizeof(kcalls));
+   if (!KS_POTRF_SMP) kstats_add_count(KS_POTRF, reps*kcalls[KS_POTRF]);
+#ifdef COEXEC
+   //NOTE: The SMP variants of the co-executed kernels are timed and counted by themselves
+   if (!KS_TRSM_SMP) kstats_add_count(KS_TRSM, reps*kcalls[KS_TRSM] - coexec_count(CX_SMP, CX_TRSM));
+   kstats_add_count(KS_SYRK, reps*kcalls[KS_SYRK] - coexec_count(CX_SMP, CX_SYRK));
+   kstats_add_count(KS_GEMM, reps*kcalls[KS_GEMM] - coexec_count(CX_SMP, CX_GEMM));
+#else
+   if (!KS_TRSM_SMP) kstats_add_count(KS_TRSM, reps*kcalls[KS_TRSM]);
+   if (!KS_UPDATE_SMP) kstats_add_count(KS_SYRK, reps*kcalls[KS_SYRK]);
+   if (!KS_UPDATE_SMP) kstats_add_count(KS_GEMM, reps*kcalls[KS_GEMM]);
+#endif
+#endif
+
+   double tExecMin, tExecMed, tExecStd;
+   double perfMin, perfMed, perfStd;
+   sample_stats(reps, times, &tExecMin, &tExecMed, &tExecStd);
+   sample_stats(reps, perfs, &perfMin, &perfMed, &perfStd);
+   free(perfs);
+   free(times);
+
+   // Low-rank update of the factor, to compare with the refactorizations above.
+   // Vb holds V and the working copy that cholesky_update overwrites
+   type_t *Vb = NULL;
+   int urow = 0; // row where the downdated matrix stops being positive definite, 0 if the update succeeded
+   double tEndUpdate = tEndExec, tUpdate = 0;
+   if ( urank > 0 ) {
+      int VSEED[4] = {0,1,2,3};
+      int intTWO = 2;
+      const int len = n*urank;
+      Vb = malloc(2*(size_t)len*sizeof(type_t));
+      assert(Vb != NULL);
+      larnv(&intTWO, &VSEED[0], &len, Vb);
+      memcpy(Vb + len, Vb, len*sizeof(type_t));
+
+      const double tIniUpdate = wall_time();
+      urow = cholesky_update(nt, urank, down, Ab, Vb + len);
+      // From now on, the generated matrix and the checks are A + V*V' or A - V*V'
+      gen_set_lowrank(urank, down, Vb);
+      if ( urow != 0 ) {
+         gen_matrix_blocked(n, nt, seed, Ab);
+         cholesky_blocked(nt, la, Ab);
+         #pragma oss taskwait
+      }
+      tEndUpdate = wall_time();
+      tUpdate = tEndUpdate - tIniUpdate;
+   }
+
+   const double tIniFlush = tEndUpdate;
+
+   if ( ooc == NULL ) {
+      flushData(Ab, ntiles*ts*ts);
+   }
+
+   #pragma oss taskwait
+
+   const double tEndFlush = wall_time();
+   const double tIniToLinear = tEndFlush;
+
+   if ( batch == 0 && !wback && ooc == NULL && band < 0 ) {
+      convert_to_linear(nt, n, Ab, (type_t (*)[n]) matrix);
+      #pragma oss taskwait
+   }
 
    const double tEndToLinear = wall_time();
    const double tIniCheck = tEndToLinear;
 
-   if ( check == 1 ) {
-      const char uplo = 'L';
-      if ( check_factorization(n, original_matrix, matrix, n, uplo) ) check = 10;
-      free(original_matrix);
+   if ( batch > 0 ) {
+      if ( (check == 1 || check == 3) && check_batch(n, batch, seed, Ab) ) check = 10;
+   } else if ( check == 1 ) {
+      if ( check_factorization(n, nt, seed, Ab) ) check = 10;
+   } else if ( check == 3 ) {
+      if ( check_factorization_probes(n, nt, seed, Ab, ooc ? &store : NULL, At) ) check = 10;
    }
+   if ( (check == 1 || check == 3) && mixed ) {
+      if ( check_refine(n, nt, seed, nrhs, Bd, Xd) ) check = 10;
+   } else if ( (check == 1 || check == 3) && nrhs > 0 ) {
+      if ( check_solve(n, nt, nq, seed, Xb, Bb) ) check = 10;
+   }
+   free(Bd);
+   free(Xd);
+   free(Bb);
+   free(Xb);
+   gen_set_lowrank(0, 0, NULL);
+   free(Vb);
 
    const double tEndCheck = wall_time();
 
    // Print results
-   float gflops = (float)n/1e3;
-   gflops = (gflops*gflops*gflops/3.f)/(tEndExec - tIniExec);
    printf( "==================== RESULTS ===================== \n" );
    printf( "  Benchmark: %s (%s)\n", "Cholesky", "OmpSs" );
    printf( "  Elements type: %s\n", ELEM_T_STR );
 #ifdef VERBOSE
    printf( "  Matrix size:           %dx%d\n", n, n);
    printf( "  Block size:            %dx%d\n", ts, ts);
+   printf( "  Lookahead:             %d\n", la);
+   printf( "  Super-tile size:       %d\n", hs);
+   printf( "  Incremental write-back: %d\n", wback);
+   printf( "  Matrix allocator:      %s\n", amap ? "mmap" : tile_alloc_name(akind));
+   printf( "  Right-hand sides:      %d\n", nrhs);
 #endif
    printf( "  Init. time (secs):     %f\n", tEndStart    - tIniStart );
    printf( "  Warm up time (secs):   %f\n", tEndWarm     - tIniWarm );
-   printf( "  Execution time (secs): %f\n", tEndExec     - tIniExec );
+   printf( "  Execution time (secs): %f\n", tExecMed );
    printf( "  Flush time (secs):     %f\n", tEndFlush    - tIniFlush );
    printf( "  Convert linear (secs): %f\n", tEndToLinear - tIniToLinear );
    printf( "  Checking time (secs):  %f\n", tEndCheck    - tIniCheck );
-   printf( "  Performance (GFLOPS):  %f\n", gflops );
+   printf( "  Performance (GFLOPS):  %f\n", perfMed );
+   if ( batch > 0 ) {
+      printf( "  Batch size:            %d\n", batch );
+      printf( "  Matrices per second:   %f\n", batch/tExecMed );
+   }
+   if ( band >= 0 ) {
+      int annz = 0;
+      for (int t = 0; t < NUM_TILES(nt); t++) annz += anz[t];
+      printf( "  Nonzero tiles:         %d of %d, %d before the fill-in\n", nnz, NUM_TILES(nt), annz );
+      printf( "  Factorization GFLOP:   %f (%f dense)\n", flops/1e9, (double)n*n*n/3.0/1e9 );
+   }
+   if ( ooc != NULL ) {
+      printf( "  Out-of-core cache (MB): %d\n", cache_mb );
+      printf( "  Out-of-core I/O (MB):  read %f, written %f\n", ostats.bytes_read/1048576.0, ostats.bytes_written/1048576.0 );
+      printf( "  Tile cache hit rate:   %f\n", 1.0 - (double)ostats.reads/ostats.accesses );
+   }
+   if ( urank > 0 ) {
+      printf( "  Rank-%d %s (secs): %f, %f times faster than refactorizing\n", urank,
+         down ? "downdate" : "update", tUpdate, tExecMed/tUpdate );
+      if ( urow != 0 ) {
+         printf( "  Refactorized:          not positive definite at row %d after the downdate\n", urow );
+      }
+   }
+   if ( mixed ) {
+      if ( iters < 0 ) {
+         printf( "  Refinement steps:      did not converge, solved in double\n" );
+      } else {
+         printf( "  Refinement steps:      %d\n", iters );
+      }
+   }
+   if ( reps > 1 ) {
+      printf( "  Repetitions:           %d\n", reps );
+      printf( "  Exec. min/median/stddev (secs):   %f / %f / %f\n", tExecMin, tExecMed, tExecStd );
+      printf( "  Perf. min/median/stddev (GFLOPS): %f / %f / %f\n", perfMin, perfMed, perfStd );
+   }
    printf( "================================================== \n" );
+#ifdef KERNEL_STATS
+   kstats_print(ts);
+   printf( "================================================== \n" );
+   char * const kstats_str = kstats_json(ts);
+#else
+   char * const kstats_str = NULL;
+#endif
+#ifdef COEXEC
+   coexec_print(ts);
+   printf( "================================================== \n" );
+   char * const coexec_str = coexec_json(ts);
+#else
+   char * const coexec_str = NULL;
+#endif
 
    // Free blocked matrix
-   free(Ab);
+   if ( amap ) {
+      tilefile_unmap(&ahdr, Ab, amap == 2);
+   } else {
+      tile_free(akind, Ab, s*ctiles);
+   }
 
    //Create the JSON result file
    FILE *res_file = fopen("test_result.json", "w+");
@@ -485,6 +2307,35 @@ int main(int argc, char* argv[])
          \"argv\": \"%d %d %d\", \
          \"exectime\": \"%f\", \
          \"performance\": \"%f\", \
+         \"lookahead\": \"%d\", \
+         \"super_tile\": \"%d\", \
+         \"incremental_writeback\": \"%d\", \
+         \"allocator\": \"%s\", \
+         \"nonzero_tiles\": \"%d\", \
+         \"flops\": \"%f\", \
+         \"ooc_cache_mb\": \"%d\", \
+         \"ooc_read_mb\": \"%f\", \
+         \"ooc_written_mb\": \"%f\", \
+         \"ooc_hit_rate\": \"%f\", \
+         \"update_rank\": \"%d\", \
+         \"update_downdate\": \"%d\", \
+         \"update_time\": \"%f\", \
+         \"update_speedup\": \"%f\", \
+         \"update_refactorized_row\": \"%d\", \
+         \"nrhs\": \"%d\", \
+         \"repetitions\": \"%d\", \
+         \"mixed_precision\": \"%d\", \
+         \"refine_iters\": \"%d\", \
+         \"batch\": \"%d\", \
+         \"matrices_per_sec\": \"%f\", \
+         \"kernel_stats\": %s, \
+         \"coexec\": %s, \
+         \"exectime_min\": \"%f\", \
+         \"exectime_median\": \"%f\", \
+         \"exectime_stddev\": \"%f\", \
+         \"performance_min\": \"%f\", \
+         \"performance_median\": \"%f\", \
+         \"performance_stddev\": \"%f\", \
          \"note\": \"datatype %s, init %f, warm %f, exec %f, flush %f, to_linear %f, check %f\" \
       }",
       "cholesky",
@@ -494,20 +2345,60 @@ int main(int argc, char* argv[])
       SYRK_NUM_ACCS, GEMM_NUM_ACCS, TRSM_NUM_ACCS, BLOCK_SIZE,
       RUNTIME_MODE,
       n, ts, check,
-      tEndExec - tIniExec,
-      gflops,
+      tExecMed,
+      perfMed,
+      la,
+      hs,
+      wback,
+      amap ? "mmap" : tile_alloc_name(akind),
+      batch > 0 ? ntiles : nnz,
+      flops,
+      ooc != NULL ? cache_mb : 0,
+      ooc != NULL ? ostats.bytes_read/1048576.0 : 0.0,
+      ooc != NULL ? ostats.bytes_written/1048576.0 : 0.0,
+      ooc != NULL ? 1.0 - (double)ostats.reads/ostats.accesses : 0.0,
+      urank,
+      down,
+      tUpdate,
+      urank > 0 ? tExecMed/tUpdate : 0.0,
+      urow,
+      nrhs,
+      reps,
+      mixed,
+      iters,
+      batch,
+      (batch > 0 ? batch : 1)/tExecMed,
+      kstats_str != NULL ? kstats_str : "null",
+      coexec_str != NULL ? coexec_str : "null",
+      tExecMin, tExecMed, tExecStd,
+      perfMin, perfMed, perfStd,
       ELEM_T_STR,
       tEndStart - tIniStart,
       tEndWarm - tIniWarm,
-      tEndExec - tIniExec,
+      tExecMed,
       tEndFlush - tIniFlush,
       tEndToLinear - tIniToLinear,
       tEndCheck - tIniCheck
    );
    fclose(res_file);
+   free(kstats_str);
+   free(coexec_str);
+#ifdef KERNEL_STATS
+   kstats_free();
+#endif
 
    // Free matrix
    free(matrix);
+   free(At);
+   free(lnz);
+   free(anz);
+   if ( ooc != NULL ) {
+      ooc_close(&store);
+   }
+   if ( Asrc != NULL ) {
+      tilefile_unmap(&ihdr, Asrc, 0);
+   }
 
    return check == 10 ? 1 : 0;
 }
+#endif //CHOLESKY_LIB
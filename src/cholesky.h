@@ -25,6 +25,10 @@
 * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifndef __CHOLESKY_H__
+#define __CHOLESKY_H__
+
+#include <stdint.h>
 #include <sys/time.h>
 #include <time.h>
 #include <math.h>
@@ -38,6 +42,9 @@
 //NOTE: Cannot throw the error as Vivado HLS will not compile
 //# error No backend library found. See README for more information
 #endif
+#ifdef CHOLESKY_MPI
+# include <mpi.h>
+#endif
 
 #ifndef BLOCK_SIZE
 #  error BLOCK_SIZE not defined
@@ -66,10 +73,12 @@
 #if defined(USE_DOUBLE)
 #  define type_t     double
 #  define ELEM_T_STR "double"
+#  define type_sqrt  sqrt
 #  define gemm       cblas_dgemm
 #  define trsm       cblas_dtrsm
 #  define trmm       cblas_dtrmm
 #  define syrk       cblas_dsyrk
+#  define MPI_TYPE_T MPI_DOUBLE
 #  if USE_MKL
 #    define potrf    dpotrf
 #    define lacpy    dlacpy
@@ -84,10 +93,12 @@
 #else
 #  define type_t     float
 #  define ELEM_T_STR "float"
+#  define type_sqrt  sqrtf
 #  define gemm       cblas_sgemm
 #  define trsm       cblas_strsm
 #  define trmm       cblas_strmm
 #  define syrk       cblas_ssyrk
+#  define MPI_TYPE_T MPI_FLOAT
 #  if USE_MKL
 #    define potrf    spotrf
 #    define lacpy    slacpy
@@ -100,6 +111,14 @@
 #    define larnv    LAPACK_slarnv
 #  endif
 #endif
+// Double precision routines, used regardless of type_t by the mixed precision mode
+#if USE_MKL
+#  define larnv_d    dlarnv
+#  define posv_d     dposv
+#else
+#  define larnv_d    LAPACK_dlarnv
+#  define posv_d     LAPACK_dposv
+#endif
 #define CBLAS_MAT_ORDER   CblasColMajor
 #define CBLAS_T           CblasTrans
 #define CBLAS_NT          CblasNoTrans
@@ -109,13 +128,105 @@
 #define CBLAS_RI          CblasRight
 #define CBLAS_NU          CblasNonUnit
 
-double wall_time () {
+// Packed lower-triangular tile layout. Only tiles (i,j) with j <= i are stored,
+// row by row, so tile (i,j) is the TILE_IDX(i,j)-th tile of the blocked matrix
+#define TILE_IDX(i, j)    ((i)*((i) + 1)/2 + (j))
+#define NUM_TILES(nt)     ((nt)*((nt) + 1)/2)
+
+// Tiles of a batch of nb n x n matrices. Matrices smaller than a tile are packed
+// ts/n per tile along its diagonal, larger ones are stored one after the other
+#define BATCH_TILES(n, nb) ((n) < ts ? ((nb) + ts/(n) - 1)/(ts/(n)) : (nb)*NUM_TILES((n)/ts))
+
+// Pure SMP builds do not bake the tile size into any accelerator, so it can be chosen at run time
+#if defined(OPENBLAS_IMPL) && defined(POTRF_SMP) && defined(TRSM_SMP)
+#  define DYNAMIC_TS
+extern int ts; // tile size
+#else
+extern const int ts; // tile size
+#endif
+
+// Blocked factorization and solve (cholesky.c)
+void cholesky_blocked_sync(const int nt, const int la, type_t* A);
+void cholesky_solve_blocked(const int nt, const int nq, const type_t *L, type_t *X);
+void convert_to_linear(const int nt, const int N, type_t *A, type_t (*Alin)[N]);
+int cholesky_update(const int nt, const int nk, const int down, type_t *L, type_t *V);
+
+#ifdef CHOLESKY_MPI
+// Distributed factorization (cholesky.c). The tiles are owned 2D block-cyclically
+// by a P x Q grid of processes, tile (i,j) by the process of rank DIST_RANK(d, i, j)
+typedef struct {
+   MPI_Comm comm;
+   int P, Q;                        // process grid
+   int p, q;                        // coordinates of this process, its rank is p*Q + q
+   double comm_time;                // time blocked waiting for messages since the last reset (secs)
+   uint64_t bytes_sent, bytes_recv; // tile traffic since the last reset
+} dist_t;
+#define DIST_RANK(d, i, j) (((i) % (d)->P)*(d)->Q + (j) % (d)->Q)
+void cholesky_dist(const int nt, type_t * const *T, dist_t *d);
+#endif
+
+// Mixed precision iterative refinement (refine.c)
+#define REFINE_ITERMAX 30 // refinement steps before falling back to a double precision factorization
+int cholesky_refine(const int n, const int nt, const uint64_t seed, const type_t *L,
+   const int nrhs, const double *B, double *X);
+void cholesky_solve_d(const int n, const int nt, const uint64_t seed,
+   const int nrhs, const double *B, double *X);
+int check_refine(const int n, const int nt, const uint64_t seed,
+   const int nrhs, const double *B, const double *X);
+
+// Matrix generator (matgen.c)
+uint64_t gen_seed(const int iseed[4]);
+uint64_t gen_jump(const uint64_t seed, const uint64_t count);
+void gen_tile(const int n, const uint64_t seed, const int i, const int j, type_t *A);
+void gen_tile_d(const int n, const uint64_t seed, const int i, const int j, double *A);
+void gen_matrix_blocked(const int n, const int nt, const uint64_t seed, type_t *A);
+void gen_matrix_linear(const int n, const uint64_t seed, const int ld, type_t *A);
+void gen_batch(const int n, const int nb, const uint64_t seed, type_t *A);
+void gen_set_source(const type_t *A, const int nt, const int lower);
+void gen_set_mask(const char *nz);
+void gen_set_lowrank(const int nk, const int down, const type_t *V);
+void gen_matrix_tiles(const int n, const int nt, const uint64_t seed, type_t * const *T);
+
+// Out-of-core tile store (ooc.c), the packed tiles of the blocked matrix in a file
+typedef struct {
+   int fd;
+   uint64_t bytes_read, bytes_written; // I/O since the last reset
+   uint64_t accesses, reads;           // tile operands of the kernels, and tiles read from the file
+} ooc_store_t;
+int ooc_open(ooc_store_t *st, const char *path, const int nt);
+void ooc_close(ooc_store_t *st);
+void ooc_reset_stats(ooc_store_t *st);
+void ooc_read(ooc_store_t *st, const int i, const int j, const int c, type_t *buf);
+void ooc_write(ooc_store_t *st, const int i, const int j, const int c, const type_t *buf);
+void ooc_gen_matrix(const int n, const int nt, const uint64_t seed, ooc_store_t *st);
+
+// Binary tiled matrix files (tilefile.c)
+#define TILEFILE_MAGIC   "CHOLTILE"
+#define TILEFILE_VERSION 1
+#define TILEFILE_LOWER   1 // only the lower tiles, in the order of the blocked matrix, otherwise all nt x nt tiles by rows
+#define TILEFILE_FACTOR  2 // the tiles hold the Cholesky factor L
+typedef struct {
+   char     magic[8];    // TILEFILE_MAGIC, without the terminating NUL
+   uint32_t version;     // TILEFILE_VERSION
+   uint32_t elem_size;   // 4 (float) or 8 (double)
+   uint64_t n;           // matrix size
+   uint32_t ts;          // tile size, each tile is column-major
+   uint32_t flags;       // TILEFILE_LOWER | TILEFILE_FACTOR
+   uint64_t seed;        // seed of the generated matrix, 0 for external data
+   uint64_t data_offset; // of the first tile, a multiple of the page size
+} tilefile_header_t;
+type_t *tilefile_map(const char *path, const int writable, tilefile_header_t *hdr);
+type_t *tilefile_create(const char *path, const int n, const uint32_t flags, const uint64_t seed,
+   tilefile_header_t *hdr);
+void tilefile_unmap(const tilefile_header_t *hdr, type_t *A, const int sync);
+
+static inline double wall_time () {
    struct timespec ts;
    clock_gettime(CLOCK_MONOTONIC,&ts);
    return (double) (ts.tv_sec) + (double) ts.tv_nsec * 1.0e-9;
 }
 
-static type_t pow_di(type_t x, int n)
+static inline type_t pow_di(type_t x, int n)
 {
    type_t rv = 1.0;
 
@@ -131,3 +242,4 @@ static type_t pow_di(type_t x, int n)
    return rv;
 }
 
+#endif //__CHOLESKY_H__
@@ -0,0 +1,171 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __CHOLESKY_SMP_H__
+#define __CHOLESKY_SMP_H__
+
+//NOTE: Only with SMP_KERNELS, which the Makefile never passes to the design and bitstream
+//      targets: the accelerators are generated from the task bodies after the host preprocessor
+#ifdef SMP_KERNELS
+
+// Host versions of the trsm, syrk and gemm kernels, used instead of the HLS
+// loops when those are compiled for the CPU (no BLAS task variant). They work
+// on BLOCK_SIZE x BLOCK_SIZE column-major tiles with the GCC vector
+// extensions, so they map to AVX-512, AVX2, SSE or NEON registers depending on
+// the target flags, and each kernel keeps a block of SMP_MR vectors x SMP_NR
+// columns of the result in registers.
+
+#if defined(__AVX512F__)
+#  define SMP_VBYTES 64
+#elif defined(__AVX__)
+#  define SMP_VBYTES 32
+#else
+#  define SMP_VBYTES 16
+#endif
+#ifdef USE_DOUBLE
+#  define SMP_VLEN (SMP_VBYTES/8)                  // elements per vector
+#else
+#  define SMP_VLEN (SMP_VBYTES/4)
+#endif
+#define SMP_MR    2                                // vectors per register block
+#define SMP_NR    4                                // columns per register block
+#define SMP_MB    (SMP_MR*SMP_VLEN)                // rows per register block
+
+typedef type_t smp_vec_t __attribute__((vector_size(SMP_VBYTES)));
+typedef type_t smp_uvec_t __attribute__((vector_size(SMP_VBYTES), aligned(sizeof(type_t))));
+
+//NOTE: Tiles are not guaranteed to be vector aligned, so loads and stores go through smp_uvec_t
+#define SMP_LOAD(p)       (*(const smp_uvec_t *)(p))
+#define SMP_STORE(p, v)   (*(smp_uvec_t *)(p) = (v))
+
+// The register blocks must tile BLOCK_SIZE
+#if BLOCK_SIZE % SMP_MB != 0 || BLOCK_SIZE % SMP_NR != 0
+#  error "SMP_KERNELS needs a BLOCK_SIZE multiple of the register block"
+#endif
+
+// acc[r][c] = sum over k of A(i0 + rows of r, k)*B(j0 + c, k), for k < kend
+static inline void smp_block_abt(const type_t *A, const type_t *B, const int i0, const int j0,
+   const int kend, smp_vec_t acc[SMP_MR][SMP_NR])
+{
+   for (int r = 0; r < SMP_MR; r++) {
+      for (int c = 0; c < SMP_NR; c++) {
+         acc[r][c] = (smp_vec_t){0};
+      }
+   }
+   for (int k = 0; k < kend; k++) {
+      smp_vec_t a[SMP_MR];
+      for (int r = 0; r < SMP_MR; r++) {
+         a[r] = SMP_LOAD(&A[k*BLOCK_SIZE + i0 + r*SMP_VLEN]);
+      }
+      for (int c = 0; c < SMP_NR; c++) {
+         const type_t b = B[k*BLOCK_SIZE + j0 + c];
+         for (int r = 0; r < SMP_MR; r++) {
+            acc[r][c] += a[r]*b;
+         }
+      }
+   }
+}
+
+// C = C - A*B'
+static inline void smp_gemm(const type_t *A, const type_t *B, type_t *C)
+{
+   smp_vec_t acc[SMP_MR][SMP_NR];
+
+   for (int j = 0; j < BLOCK_SIZE; j += SMP_NR) {
+      for (int i = 0; i < BLOCK_SIZE; i += SMP_MB) {
+         smp_block_abt(A, B, i, j, BLOCK_SIZE, acc);
+         for (int c = 0; c < SMP_NR; c++) {
+            for (int r = 0; r < SMP_MR; r++) {
+               type_t * const Cp = &C[(j + c)*BLOCK_SIZE + i + r*SMP_VLEN];
+               SMP_STORE(Cp, SMP_LOAD(Cp) - acc[r][c]);
+            }
+         }
+      }
+   }
+}
+
+// B = B - A*A', only the lower triangle of B is updated
+static inline void smp_syrk(const type_t *A, type_t *B)
+{
+   smp_vec_t acc[SMP_MR][SMP_NR];
+
+   for (int j = 0; j < BLOCK_SIZE; j += SMP_NR) {
+      for (int i = j/SMP_MB*SMP_MB; i < BLOCK_SIZE; i += SMP_MB) {
+         smp_block_abt(A, A, i, j, BLOCK_SIZE, acc);
+         if (i >= j + SMP_NR) {
+            for (int c = 0; c < SMP_NR; c++) {
+               for (int r = 0; r < SMP_MR; r++) {
+                  type_t * const Bp = &B[(j + c)*BLOCK_SIZE + i + r*SMP_VLEN];
+                  SMP_STORE(Bp, SMP_LOAD(Bp) - acc[r][c]);
+               }
+            }
+         } else {
+            // Block crossing the diagonal
+            for (int c = 0; c < SMP_NR; c++) {
+               for (int r = 0; r < SMP_MB; r++) {
+                  if (i + r >= j + c) {
+                     B[(j + c)*BLOCK_SIZE + i + r] -= acc[r/SMP_VLEN][c][r%SMP_VLEN];
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+// B = B*inv(A'), A lower triangular. Each block of rows of B is solved
+// left-looking, column by column, with the already solved columns.
+static inline void smp_trsm(const type_t *A, type_t *B)
+{
+   type_t inv[BLOCK_SIZE];
+
+   for (int k = 0; k < BLOCK_SIZE; k++) {
+      inv[k] = 1. / A[k*BLOCK_SIZE + k];
+   }
+
+   for (int i = 0; i < BLOCK_SIZE; i += SMP_MB) {
+      for (int k = 0; k < BLOCK_SIZE; k++) {
+         smp_vec_t acc[SMP_MR];
+         for (int r = 0; r < SMP_MR; r++) {
+            acc[r] = SMP_LOAD(&B[k*BLOCK_SIZE + i + r*SMP_VLEN]);
+         }
+         for (int m = 0; m < k; m++) {
+            const type_t a = A[m*BLOCK_SIZE + k];
+            for (int r = 0; r < SMP_MR; r++) {
+               acc[r] -= SMP_LOAD(&B[m*BLOCK_SIZE + i + r*SMP_VLEN])*a;
+            }
+         }
+         for (int r = 0; r < SMP_MR; r++) {
+            SMP_STORE(&B[k*BLOCK_SIZE + i + r*SMP_VLEN], acc[r]*inv[k]);
+         }
+      }
+   }
+}
+
+#endif //SMP_KERNELS
+
+#endif //__CHOLESKY_SMP_H__
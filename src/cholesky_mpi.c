@@ -0,0 +1,458 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// Benchmark driver of the distributed factorization, one process per node or
+// per FPGA. Every process generates and factorizes only the tiles it owns.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "cholesky.h"
+#include "tilealloc.h"
+
+#define CHECK_PROBES 4 // random probe vectors of the randomized check
+
+static int cmp_double(const void *a, const void *b)
+{
+   const double x = *(const double *)a, y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+// Y += op(A)*X for a ts x nrhs row tile X, only the lower triangle of diagonal tiles
+static void probe_gemm(const int nrhs, const int trans, const int diag,
+   const type_t *A, const type_t *X, type_t *Y)
+{
+   if (diag) {
+      type_t *T = (type_t *)malloc(ts*nrhs*sizeof(type_t));
+      memcpy(T, X, ts*nrhs*sizeof(type_t));
+      trmm(CBLAS_MAT_ORDER, CBLAS_LF, CBLAS_LO, trans ? CBLAS_T : CBLAS_NT, CBLAS_NU,
+         ts, nrhs, 1.0, A, ts, T, ts);
+      for (int e = 0; e < ts*nrhs; e++) {
+         Y[e] += T[e];
+      }
+      free(T);
+   } else {
+      gemm(CBLAS_MAT_ORDER, trans ? CBLAS_T : CBLAS_NT, CBLAS_NT,
+         ts, nrhs, ts, 1.0, A, ts, X, ts, 1.0, Y, ts);
+   }
+}
+
+// Randomized check of the distributed factor, as check_factorization_probes.
+// Every process applies its own tiles of A and L to the probe vectors and the
+// partial products are summed over the grid, so no process holds the matrix.
+static int check_dist(const int n, const int nt, const uint64_t seed, type_t * const *T, const dist_t *d)
+{
+   const int nrhs = CHECK_PROBES;
+   int ISEED[4] = {1,2,3,5};
+   int intTWO = 2;
+   const int len = n*nrhs;
+   // Probe-like vectors, stored by row tiles of ts x nrhs elements
+   type_t *X = (type_t *)malloc(n*nrhs*sizeof(type_t));
+   type_t *Y = (type_t *)calloc(n*nrhs, sizeof(type_t));
+   type_t *Z = (type_t *)calloc(n*nrhs, sizeof(type_t));
+   type_t *W = (type_t *)calloc(n*nrhs, sizeof(type_t));
+   type_t *Asum = (type_t *)calloc(n, sizeof(type_t));
+   type_t *Atile = (type_t *)malloc(ts*ts*sizeof(type_t));
+   assert(X != NULL && Y != NULL && Z != NULL && W != NULL && Asum != NULL && Atile != NULL);
+
+   larnv(&intTWO, &ISEED[0], &len, X);
+   for (int e = 0; e < n*nrhs; e++) {
+      X[e] = X[e] < 0 ? -1 : 1;
+   }
+
+   // Y = A*X and the row sums of |A|, with A(j,i) = A(i,j)'
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         if (T[TILE_IDX(i, j)] == NULL) continue;
+         gen_tile(n, seed, i, j, Atile);
+         gemm(CBLAS_MAT_ORDER, CBLAS_NT, CBLAS_NT, ts, nrhs, ts, 1.0, Atile, ts,
+            X + j*ts*nrhs, ts, 1.0, Y + i*ts*nrhs, ts);
+         for (int c = 0; c < ts; c++) {
+            for (int r = 0; r < ts; r++) {
+               Asum[i*ts + r] += fabs(Atile[c*ts + r]);
+            }
+         }
+         if (i == j) continue;
+         gemm(CBLAS_MAT_ORDER, CBLAS_T, CBLAS_NT, ts, nrhs, ts, 1.0, Atile, ts,
+            X + i*ts*nrhs, ts, 1.0, Y + j*ts*nrhs, ts);
+         for (int c = 0; c < ts; c++) {
+            for (int r = 0; r < ts; r++) {
+               Asum[j*ts + c] += fabs(Atile[c*ts + r]);
+            }
+         }
+      }
+   }
+   MPI_Allreduce(MPI_IN_PLACE, Y, n*nrhs, MPI_TYPE_T, MPI_SUM, d->comm);
+   MPI_Allreduce(MPI_IN_PLACE, Asum, n, MPI_TYPE_T, MPI_SUM, d->comm);
+
+   // Z = L'*X
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         if (T[TILE_IDX(i, j)] == NULL) continue;
+         probe_gemm(nrhs, 1, i == j, T[TILE_IDX(i, j)], X + i*ts*nrhs, Z + j*ts*nrhs);
+      }
+   }
+   MPI_Allreduce(MPI_IN_PLACE, Z, n*nrhs, MPI_TYPE_T, MPI_SUM, d->comm);
+
+   // W = L*Z
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         if (T[TILE_IDX(i, j)] == NULL) continue;
+         probe_gemm(nrhs, 0, i == j, T[TILE_IDX(i, j)], Z + j*ts*nrhs, W + i*ts*nrhs);
+      }
+   }
+   MPI_Allreduce(MPI_IN_PLACE, W, n*nrhs, MPI_TYPE_T, MPI_SUM, d->comm);
+
+   type_t Rnorm = 0, Anorm = 0;
+   for (int r = 0; r < n; r++) {
+      const int i = r/ts, ri = r%ts;
+      type_t sq = 0;
+      for (int q = 0; q < nrhs; q++) {
+         const type_t e = Y[(i*nrhs + q)*ts + ri] - W[(i*nrhs + q)*ts + ri];
+         sq += e*e;
+      }
+      sq = sqrt(n*sq/nrhs);
+      Rnorm = sq > Rnorm ? sq : Rnorm;
+      Anorm = Asum[r] > Anorm ? Asum[r] : Anorm;
+   }
+
+#ifdef USE_DOUBLE
+   const type_t eps = pow_di(2.0, -53);
+#else
+   const type_t eps = pow_di(2.0, -24);
+#endif
+   const int info_factorization = isnan(Rnorm/(Anorm*n*eps)) ||
+      isinf(Rnorm/(Anorm*n*eps)) || (Rnorm/(Anorm*n*eps) > 60.0);
+
+   if (d->p == 0 && d->q == 0) {
+      printf("==================================================\n");
+      printf("Checking the Cholesky Factorization \n");
+#ifdef VERBOSE
+      printf("-- Rnorm = %e \n", Rnorm);
+      printf("-- Anorm = %e \n", Anorm);
+      printf("-- ||L'L-A||_oo/(||A||_oo.N.eps) = %e \n",Rnorm/(Anorm*n*eps));
+#endif
+      if ( info_factorization ){
+         fprintf(stderr, "\n-- Factorization is suspicious ! \n\n");
+      } else {
+         printf("\n-- Factorization is CORRECT ! \n\n");
+      }
+   }
+
+   free(Atile);
+   free(Asum);
+   free(W);
+   free(Z);
+   free(Y);
+   free(X);
+
+   return info_factorization;
+}
+
+// Gathers the distributed tiles into the blocked matrix Ab of rank 0
+//NOTE: All the tiles use the same tag, as TILE_IDX can exceed MPI_TAG_UB. Every rank sends its
+//      tiles in the order rank 0 posts the receives, so the non-overtaking rule matches them.
+static void gather_tiles(const int nt, type_t * const *T, type_t *Ab, const dist_t *d)
+{
+   const int rank = d->p*d->Q + d->q;
+   MPI_Request *req = (MPI_Request *)malloc(NUM_TILES(nt)*sizeof(MPI_Request));
+   int nreq = 0;
+
+   assert(req != NULL);
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         const int owner = DIST_RANK(d, i, j);
+         if (rank == 0 && owner == 0) {
+            memcpy(Ab + TILE_IDX(i, j)*ts*ts, T[TILE_IDX(i, j)], ts*ts*sizeof(type_t));
+         } else if (rank == 0) {
+            MPI_Irecv(Ab + TILE_IDX(i, j)*ts*ts, ts*ts, MPI_TYPE_T, owner, 0, d->comm, &req[nreq++]);
+         } else if (owner == rank) {
+            MPI_Isend(T[TILE_IDX(i, j)], ts*ts, MPI_TYPE_T, 0, 0, d->comm, &req[nreq++]);
+         }
+      }
+   }
+   MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+   free(req);
+}
+
+int main(int argc, char* argv[])
+{
+   int reps = 1;    // number of measured factorizations
+   int prows = 0;   // rows of the process grid, 0 to pick the squarest grid
+   int gather = 0;  // gather the factor to a linear matrix in rank 0?
+   int provided, size, rank, opt;
+
+   //NOTE: Only the main task calls MPI, but it may resume in another worker
+   //      thread after a taskwait
+   MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+   MPI_Comm_size(MPI_COMM_WORLD, &size);
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+   if (provided < MPI_THREAD_SERIALIZED) {
+      if (rank == 0) fprintf( stderr, "ERROR:\tThe MPI library does not support MPI_THREAD_SERIALIZED\n" );
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+
+   while ( (opt = getopt(argc, argv, "r:p:g")) != -1 ) {
+      switch (opt) {
+         case 'r':
+            reps = atoi(optarg);
+            break;
+         case 'p':
+            prows = atoi(optarg);
+            break;
+         case 'g':
+            gather = 1;
+            break;
+         default:
+            if (rank == 0) fprintf( stderr, "USAGE:\t%s [-r <reps>] [-p <process rows>] [-g] <matrix size> [<check>]\n", argv[0] );
+            MPI_Finalize();
+            return 1;
+      }
+   }
+   if ( argc - optind < 1 ) {
+      if (rank == 0) fprintf( stderr, "USAGE:\t%s [-r <reps>] [-p <process rows>] [-g] <matrix size> [<check>]\n", argv[0] );
+      MPI_Finalize();
+      return 1;
+   }
+   argc -= optind - 1;
+   argv += optind - 1;
+   const int  n = atoi(argv[1]); // matrix size
+   int check    = argc > 2 ? atoi(argv[2]) : 1; // check result?
+   int ISEED[4] = {0,0,0,1};
+   const uint64_t seed = gen_seed(ISEED);
+   if ( n % ts != 0 ) {
+      if (rank == 0) fprintf( stderr, "ERROR:\t%d is not a multiple of %d\n", n, ts );
+      MPI_Finalize();
+      return 1;
+   }
+   const int nt = n / ts; // number of tiles per row or column
+
+   if ( prows == 0 ) {
+      for (prows = 1; (prows + 1)*(prows + 1) <= size; prows++);
+      while (size % prows != 0) prows--;
+   }
+   if ( prows < 1 || size % prows != 0 ) {
+      if (rank == 0) fprintf( stderr, "ERROR:\tThe %d processes cannot form a grid of %d rows\n", size, prows );
+      MPI_Finalize();
+      return 1;
+   }
+   dist_t dist = { MPI_COMM_WORLD, prows, size/prows, rank/(size/prows), rank%(size/prows), 0, 0, 0 };
+   dist_t * const d = &dist;
+
+   const double tIniStart = wall_time();
+
+   // Owned tiles, the others stay NULL
+   type_t **T = (type_t **)calloc(NUM_TILES(nt), sizeof(type_t *));
+   int owned = 0;
+   assert(T != NULL);
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         owned += DIST_RANK(d, i, j) == rank;
+      }
+   }
+   int akind = TA_ALIGNED;
+   const size_t s = ts*ts*sizeof(type_t);
+   type_t *Al = (type_t *)tile_alloc(&akind, (owned > 0 ? owned : 1)*s);
+   if (Al == NULL) {
+      fprintf( stderr, "ERROR:\tRank %d cannot allocate its %d tiles\n", rank, owned );
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   for (int i = 0, t = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         if (DIST_RANK(d, i, j) == rank) T[TILE_IDX(i, j)] = Al + (t++)*ts*ts;
+      }
+   }
+   gen_matrix_tiles(n, nt, seed, T);
+   #pragma oss taskwait
+
+   const double tEndStart = wall_time();
+   const double tIniWarm = tEndStart;
+
+   //Warm up execution
+   if (check == 2) {
+      cholesky_dist(nt, T, d);
+      gen_matrix_tiles(n, nt, seed, T);
+      #pragma oss taskwait
+   }
+
+   const double tEndWarm = wall_time();
+   double * const times = (double *)malloc(reps*sizeof(double));
+   double tExec = 0;
+
+   //Performance execution
+   for (int r = 0; r < reps; r++) {
+      if (r > 0) {
+         gen_matrix_tiles(n, nt, seed, T);
+         #pragma oss taskwait
+      }
+      d->comm_time = 0;
+      d->bytes_sent = d->bytes_recv = 0;
+      MPI_Barrier(d->comm);
+      const double tIniExec = wall_time();
+
+      cholesky_dist(nt, T, d);
+
+      tExec = wall_time() - tIniExec;
+      // The factorization ends when the slowest process does
+      MPI_Allreduce(&tExec, &times[r], 1, MPI_DOUBLE, MPI_MAX, d->comm);
+   }
+
+   qsort(times, reps, sizeof(double), cmp_double);
+   const double tExecMin = times[0];
+   const double tExecMed = reps % 2 ? times[reps/2] : (times[reps/2 - 1] + times[reps/2])/2;
+   free(times);
+
+   // Compute and communication time, and tile traffic, of each process in the last repetition
+   double stats[4] = { tExec - d->comm_time, d->comm_time, d->bytes_sent/1048576.0, d->bytes_recv/1048576.0 };
+   double *rstats = rank == 0 ? (double *)malloc(4*size*sizeof(double)) : NULL;
+   MPI_Gather(stats, 4, MPI_DOUBLE, rstats, 4, MPI_DOUBLE, 0, d->comm);
+
+   const double tIniGather = wall_time();
+   double tGather = 0;
+   type_t *Ab = NULL, *matrix = NULL;
+
+   if ( gather ) {
+      if ( rank == 0 ) {
+         Ab = (type_t *)malloc(NUM_TILES(nt)*s);
+         matrix = (type_t *)calloc((size_t)n*n, sizeof(type_t));
+         assert(Ab != NULL && matrix != NULL);
+      }
+      gather_tiles(nt, T, Ab, d);
+      tGather = wall_time() - tIniGather;
+      if ( rank == 0 ) {
+         convert_to_linear(nt, n, Ab, (type_t (*)[n]) matrix);
+         #pragma oss taskwait
+      }
+   }
+
+   const double tEndToLinear = wall_time();
+   const double tIniCheck = tEndToLinear;
+
+   if ( check == 1 || check == 3 ) {
+      if ( check_dist(n, nt, seed, T, d) ) check = 10;
+   }
+
+   const double tEndCheck = wall_time();
+   const double perfMed = (double)n*n*n/3.0/tExecMed/1e9;
+
+   if ( rank == 0 ) {
+      // Print results
+      printf( "==================== RESULTS ===================== \n" );
+      printf( "  Benchmark: %s (%s)\n", "Cholesky", "OmpSs + MPI" );
+      printf( "  Elements type: %s\n", ELEM_T_STR );
+#ifdef VERBOSE
+      printf( "  Matrix size:           %dx%d\n", n, n);
+      printf( "  Block size:            %dx%d\n", ts, ts);
+#endif
+      printf( "  Process grid:          %dx%d\n", d->P, d->Q );
+      printf( "  Init. time (secs):     %f\n", tEndStart    - tIniStart );
+      printf( "  Warm up time (secs):   %f\n", tEndWarm     - tIniWarm );
+      printf( "  Execution time (secs): %f\n", tExecMed );
+      printf( "  Gather time (secs):    %f\n", tGather );
+      printf( "  Convert linear (secs): %f\n", tEndToLinear - tIniGather - tGather );
+      printf( "  Checking time (secs):  %f\n", tEndCheck    - tIniCheck );
+      printf( "  Performance (GFLOPS):  %f\n", perfMed );
+      if ( reps > 1 ) {
+         printf( "  Repetitions:           %d\n", reps );
+         printf( "  Exec. min/median (secs): %f / %f\n", tExecMin, tExecMed );
+      }
+      printf( "  Rank  Compute (secs)  Comm. (secs)  Sent (MB)  Received (MB)\n" );
+      for (int r = 0; r < size; r++) {
+         printf( "  %4d  %14f  %12f  %9.2f  %13.2f\n", r,
+            rstats[4*r], rstats[4*r + 1], rstats[4*r + 2], rstats[4*r + 3] );
+      }
+      printf( "================================================== \n" );
+
+      //Create the JSON result file
+      FILE *res_file = fopen("test_result.json", "w+");
+      if (res_file == NULL) {
+         printf( "Cannot open 'test_result.json' file\n" );
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+      fprintf(res_file,
+         "{ \
+            \"benchmark\": \"%s\", \
+            \"toolchain\": \"%s\", \
+            \"hwruntime\": \"%s\", \
+            \"board\": \"%s\", \
+            \"version\": \"%usyrk %ugemm %utrsm %uBS memport_128 noflush\", \
+            \"exectype\": \"%s\", \
+            \"argv\": \"%d %d %d\", \
+            \"exectime\": \"%f\", \
+            \"performance\": \"%f\", \
+            \"processes\": \"%d\", \
+            \"process_grid\": \"%dx%d\", \
+            \"gather\": \"%d\", \
+            \"repetitions\": \"%d\", \
+            \"exectime_min\": \"%f\", \
+            \"exectime_median\": \"%f\", \
+            \"ranks\": [",
+         "cholesky-mpi",
+         "ompss-2",
+         FPGA_HWRUNTIME,
+         BOARD,
+         SYRK_NUM_ACCS, GEMM_NUM_ACCS, TRSM_NUM_ACCS, BLOCK_SIZE,
+         RUNTIME_MODE,
+         n, ts, check,
+         tExecMed,
+         perfMed,
+         size,
+         d->P, d->Q,
+         gather,
+         reps,
+         tExecMin, tExecMed);
+      for (int r = 0; r < size; r++) {
+         fprintf(res_file, "%s{ \"compute\": \"%f\", \"comm\": \"%f\", \"sent_mb\": \"%f\", \"received_mb\": \"%f\" }",
+            r > 0 ? ", " : "", rstats[4*r], rstats[4*r + 1], rstats[4*r + 2], rstats[4*r + 3]);
+      }
+      fprintf(res_file,
+         "], \
+            \"note\": \"datatype %s, init %f, warm %f, exec %f, gather %f, check %f\" \
+         }",
+         ELEM_T_STR,
+         tEndStart - tIniStart,
+         tEndWarm - tIniWarm,
+         tExecMed,
+         tGather,
+         tEndCheck - tIniCheck);
+      fclose(res_file);
+
+      free(rstats);
+      free(matrix);
+      free(Ab);
+   }
+
+   tile_free(akind, Al, (owned > 0 ? owned : 1)*s);
+   free(T);
+
+   MPI_Finalize();
+   return check == 10 ? 1 : 0;
+}
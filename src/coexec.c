@@ -0,0 +1,233 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cholesky.h"
+#include "coexec.h"
+
+#define COEXEC_PIPE_DEPTH 32   // cycles to fill and drain the pipelined loops, as in dagsim
+#define COEXEC_OVERHEAD   1e-6 // runtime overhead per task (secs)
+
+static const char * const cx_names[CX_NUM] = {"trsm", "syrk", "gemm"};
+static const char * const cx_devs[CX_NUM_DEVS] = {"smp", "fpga"};
+static const unsigned int cx_fpga_accs[CX_NUM] = {TRSM_NUM_ACCS, SYRK_NUM_ACCS, GEMM_NUM_ACCS};
+
+static int cx_workers = 0;                     // SMP workers for the tile tasks, 0 until initialized
+static double cx_cost[CX_NUM_DEVS][CX_NUM];    // expected time per task (secs)
+static uint64_t cx_queued[CX_NUM];             // SMP tasks created and not finished yet
+static double cx_ready[CX_NUM];                // time when the accelerators of each kernel are expected to be free
+static uint64_t cx_run[CX_NUM_DEVS][CX_NUM];   // tasks created in the current run
+static uint64_t cx_count[CX_NUM_DEVS][CX_NUM]; // tasks created in all the measured runs
+static uint64_t cx_smp_ns;                     // time of the SMP tasks in the current run (ns)
+static double cx_smp_time;                     // time of the SMP tasks in all the measured runs
+static double cx_t0, cx_time = 0;              // start of the current run and total measured time
+
+// Flops of one kernel call on ts x ts tiles
+static double cx_flops(const int kernel, const int ts)
+{
+   const double t = ts;
+   switch (kernel) {
+      case CX_TRSM: return t*t*t;
+      case CX_SYRK: return t*t*(t + 1);
+      default:      return 2*t*t*t;
+   }
+}
+
+// Time of a kernel on its accelerator: the tiles are copied in and out through
+// the memory port and the loops of cholesky.c run at their II (see dagsim.c)
+static double cx_fpga_cost(const int kernel)
+{
+   static const int tiles_in[CX_NUM] = {2, 2, 3};
+   const double t = ts;
+   const double copy = (tiles_in[kernel] + 1)*t*t*sizeof(type_t)*8/FPGA_MEMORY_PORT_WIDTH;
+   double comp;
+   switch (kernel) {
+      case CX_TRSM: comp = t*(t + 1)/2*FPGA_OTHER_LOOP_II; break;
+      case CX_SYRK: comp = t*(ts/2 + ts%2 + 1)*FPGA_OTHER_LOOP_II; break;
+      default:      comp = t*t*FPGA_GEMM_LOOP_II; break;
+   }
+   return (copy + comp + COEXEC_PIPE_DEPTH)/(FPGA_CLOCK*1e6) + COEXEC_OVERHEAD;
+}
+
+// SMP workers for the tile tasks, 0 for all the cores but the one that creates
+// the tasks and factorizes the diagonal tiles. The first SMP costs assume the
+// cores are as fast as the accelerators, and are replaced by the measured ones.
+void coexec_init(const int smp_workers)
+{
+   const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   cx_workers = smp_workers > 0 ? smp_workers : (cores > 1 ? cores - 1 : 1);
+   for (int k = 0; k < CX_NUM; k++) {
+      cx_cost[CX_FPGA][k] = cx_fpga_cost(k);
+      cx_cost[CX_SMP][k] = cx_cost[CX_FPGA][k];
+      cx_ready[k] = 0;
+   }
+}
+
+// Returns the device of the next task of kernel and queues the task on it.
+// Several factorizations can create their tile tasks at once (see cholesky_batch)
+int coexec_pick(const int kernel)
+{
+   const double now = wall_time();
+   const double fcost = cx_cost[CX_FPGA][kernel];
+   double smp = 0, cost[CX_NUM], ready, next;
+   int dev;
+
+   if (cx_workers == 0) coexec_init(0);
+   for (int k = 0; k < CX_NUM; k++) {
+      __atomic_load(&cx_cost[CX_SMP][k], &cost[k], __ATOMIC_RELAXED);
+      smp += __atomic_load_n(&cx_queued[k], __ATOMIC_RELAXED)*cost[k];
+   }
+   smp = smp/cx_workers + cost[kernel];
+
+   __atomic_load(&cx_ready[kernel], &ready, __ATOMIC_RELAXED);
+   do {
+      const double start = ready > now ? ready : now;
+      dev = smp < start - now + fcost ? CX_SMP : CX_FPGA;
+      if (dev == CX_SMP) break;
+      next = start + fcost/cx_fpga_accs[kernel];
+   } while (!__atomic_compare_exchange(&cx_ready[kernel], &ready, &next, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+   if (dev == CX_SMP) {
+      __atomic_fetch_add(&cx_queued[kernel], 1, __ATOMIC_RELAXED);
+   }
+   __atomic_fetch_add(&cx_run[dev][kernel], 1, __ATOMIC_RELAXED);
+
+   return dev;
+}
+
+// An SMP task of kernel ended after t secs
+void coexec_done(const int kernel, const double t)
+{
+   double c;
+
+   //NOTE: Concurrent updates may lose a sample, the average is only a hint
+   __atomic_load(&cx_cost[CX_SMP][kernel], &c, __ATOMIC_RELAXED);
+   c += (t - c)/8;
+   __atomic_store(&cx_cost[CX_SMP][kernel], &c, __ATOMIC_RELAXED);
+   __atomic_fetch_sub(&cx_queued[kernel], 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&cx_smp_ns, (uint64_t)(t*1e9), __ATOMIC_RELAXED);
+}
+
+// Only the tasks between coexec_start and coexec_stop, where no other tasks are running, are counted
+void coexec_start(void)
+{
+   if (cx_workers == 0) coexec_init(0);
+   memset(cx_run, 0, sizeof(cx_run));
+   cx_smp_ns = 0;
+   cx_t0 = wall_time();
+   for (int k = 0; k < CX_NUM; k++) {
+      cx_ready[k] = cx_t0;
+   }
+}
+
+void coexec_stop(void)
+{
+   const double t = wall_time() - cx_t0;
+   const double smp = cx_smp_ns*1e-9/cx_workers; // SMP time per worker
+   double fpga = 0;                              // predicted FPGA time
+
+   for (int k = 0; k < CX_NUM; k++) {
+      fpga = cx_ready[k] - cx_t0 > fpga ? cx_ready[k] - cx_t0 : fpga;
+      for (int d = 0; d < CX_NUM_DEVS; d++) {
+         cx_count[d][k] += cx_run[d][k];
+      }
+   }
+   //NOTE: If the accelerators were expected to finish last, they set the length
+   //      of the run, so their costs are scaled by how far off the prediction was.
+   //      Otherwise their real time is unknown and the costs are kept.
+   if (fpga > smp && fpga > 0) {
+      double f = t/fpga;
+      f = f < 0.5 ? 0.5 : (f > 2 ? 2 : f);
+      for (int k = 0; k < CX_NUM; k++) {
+         cx_cost[CX_FPGA][k] *= f;
+      }
+   }
+   cx_smp_time += cx_smp_ns*1e-9;
+   cx_time += t;
+}
+
+// Tasks created on dev in the measured runs
+uint64_t coexec_count(const int dev, const int kernel)
+{
+   return cx_count[dev][kernel];
+}
+
+// Share of the flops of the measured runs done by the FPGA
+static double cx_fpga_share(const int ts)
+{
+   double total = 0, fpga = 0;
+
+   for (int k = 0; k < CX_NUM; k++) {
+      fpga += cx_count[CX_FPGA][k]*cx_flops(k, ts);
+      total += (cx_count[CX_SMP][k] + cx_count[CX_FPGA][k])*cx_flops(k, ts);
+   }
+
+   return total > 0 ? fpga/total : 0;
+}
+
+void coexec_print(const int ts)
+{
+   printf( "=================== CO-EXECUTION ================= \n" );
+   printf( "  SMP workers: %d, measured time %f secs\n", cx_workers, cx_time );
+   printf( "  %-6s %10s %10s %7s %12s %12s\n", "kernel", "smp", "fpga", "fpga%", "smp(us)", "fpga(us)" );
+   for (int k = 0; k < CX_NUM; k++) {
+      const uint64_t total = cx_count[CX_SMP][k] + cx_count[CX_FPGA][k];
+      printf( "  %-6s %10llu %10llu %7.1f %12.2f %12.2f\n", cx_names[k],
+         (unsigned long long)cx_count[CX_SMP][k], (unsigned long long)cx_count[CX_FPGA][k],
+         total > 0 ? 100.0*cx_count[CX_FPGA][k]/total : 0, cx_cost[CX_SMP][k]*1e6, cx_cost[CX_FPGA][k]*1e6 );
+   }
+   printf( "  FPGA share of the flops: %.1f%%, SMP busy %.1f%% of the workers time\n", 100*cx_fpga_share(ts),
+      cx_time > 0 ? 100*cx_smp_time/cx_workers/cx_time : 0 );
+}
+
+// Returns the split as a JSON object, to be freed by the caller
+char *coexec_json(const int ts)
+{
+   char *buf = NULL;
+   size_t len = 0;
+   FILE *f = open_memstream(&buf, &len);
+
+   if (f == NULL) return NULL;
+   fprintf(f, "{\"smp_workers\": %d, ", cx_workers);
+   for (int k = 0; k < CX_NUM; k++) {
+      fprintf(f, "\"%s\": {", cx_names[k]);
+      for (int d = 0; d < CX_NUM_DEVS; d++) {
+         fprintf(f, "\"%s_tasks\": %llu, \"%s_cost\": %e, ", cx_devs[d], (unsigned long long)cx_count[d][k],
+            cx_devs[d], cx_cost[d][k]);
+      }
+      fprintf(f, "\"fpga_accs\": %u}, ", cx_fpga_accs[k]);
+   }
+   fprintf(f, "\"fpga_flops_share\": %f, \"smp_busy\": %f}", cx_fpga_share(ts),
+      cx_time > 0 ? cx_smp_time/cx_workers/cx_time : 0);
+   fclose(f);
+
+   return buf;
+}
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __COEXEC_H__
+#define __COEXEC_H__
+
+#include <stdint.h>
+
+// Co-execution of the trsm, syrk and gemm tile tasks on the SMP cores and the
+// FPGA accelerators, compiled in with COEXEC. Each task is created as the
+// variant of the device expected to finish it first, given the work already
+// queued on each device and its cost per task. SMP tasks time themselves and
+// leave their queue when they end. FPGA tasks cannot, so their queues are
+// predicted with the accelerator model of dagsim, corrected after each run.
+
+enum { CX_SMP, CX_FPGA, CX_NUM_DEVS };
+enum { CX_TRSM, CX_SYRK, CX_GEMM, CX_NUM };
+
+#ifdef COEXEC
+#  define COEXEC_BEGIN()  const double coexec_t0 = wall_time()
+#  define COEXEC_END(k)   coexec_done((k), wall_time() - coexec_t0)
+#else
+#  define COEXEC_BEGIN()
+#  define COEXEC_END(k)
+#endif
+
+void coexec_init(const int smp_workers);
+int coexec_pick(const int kernel);
+void coexec_done(const int kernel, const double t);
+void coexec_start(void);
+void coexec_stop(void);
+uint64_t coexec_count(const int dev, const int kernel);
+void coexec_print(const int ts);
+char *coexec_json(const int ts);
+
+#endif //__COEXEC_H__
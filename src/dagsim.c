@@ -0,0 +1,600 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Host-only replay of the task graph of cholesky_blocked. The tasks are created
+// in the same order as cholesky_blocked creates them, their dependencies are
+// computed from the tiles they access like the runtime does, and the graph is
+// scheduled on a given number of accelerators per kernel with cost models of
+// the FPGA kernels, to explore accelerator mixes without building bitstreams.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define TILE_IDX(i, j)    ((i)*((i) + 1)/2 + (j))
+#define NUM_TILES(nt)     ((nt)*((nt) + 1)/2)
+
+#ifndef BLOCK_SIZE
+#  define BLOCK_SIZE 32
+#endif
+#ifndef FPGA_CLOCK
+#  define FPGA_CLOCK 200
+#endif
+#ifndef FPGA_MEMORY_PORT_WIDTH
+#  define FPGA_MEMORY_PORT_WIDTH 128
+#endif
+#ifndef FPGA_GEMM_LOOP_II
+#  define FPGA_GEMM_LOOP_II 1
+#endif
+#ifndef FPGA_OTHER_LOOP_II
+#  define FPGA_OTHER_LOOP_II 1
+#endif
+#ifndef SYRK_NUM_ACCS
+#  define SYRK_NUM_ACCS 1
+#endif
+#ifndef GEMM_NUM_ACCS
+#  define GEMM_NUM_ACCS 1
+#endif
+#ifndef TRSM_NUM_ACCS
+#  define TRSM_NUM_ACCS 1
+#endif
+#ifdef POTRF_SMP
+#  define POTRF_CORES 1
+#else
+#  define POTRF_CORES 0
+#endif
+
+#define MAX_UNITS 64      // accelerators or cores of a kernel
+#define PIPE_DEPTH 32     // cycles to fill and drain the pipelined loops of a kernel
+
+enum { K_POTRF, K_TRSM, K_SYRK, K_GEMM, K_NUM };
+static const char * const knames[K_NUM] = {"potrf", "trsm", "syrk", "gemm"};
+
+typedef struct {
+   int ts;            // tile size
+   int la;            // lookahead depth
+   int elem;          // element size (bytes)
+   double clock;      // accelerators clock (MHz)
+   int port;          // accelerators memory port width (bits)
+   int gemm_ii;       // initiation interval of the gemm loop
+   int other_ii;      // initiation interval of the syrk and trsm loops
+   int units[K_NUM];  // accelerators, or cores for SMP kernels
+   int smp[K_NUM];    // kernel runs on the SMP side?
+   double smp_gflops; // performance of a core for SMP kernels
+   double overhead;   // runtime overhead per task (secs)
+} config_t;
+
+typedef struct {
+   int kernel;
+   int i, j, k;       // tile coordinates, (k,k) for potrf, (i,k) for trsm, (j,k) for syrk, (i,j) updated with panel k for gemm
+   int ndeps, *deps;  // predecessors
+   int nsucc, *succ;  // successors
+   double cost;       // execution time (secs)
+   double ready, start, end;
+   int unit;
+} task_t;
+
+typedef struct {
+   int ntasks, cap;
+   task_t *tasks;
+   // Last writer and readers since then of every tile
+   int *writer;
+   int *nreaders, **readers, *rcap;
+} dag_t;
+
+static void add_dep(dag_t *g, const int pred, const int succ)
+{
+   task_t *t = &g->tasks[succ];
+   if (pred < 0) return;
+   for (int d = 0; d < t->ndeps; d++) {
+      if (t->deps[d] == pred) return;
+   }
+   t->deps = (int *)realloc(t->deps, (t->ndeps + 1)*sizeof(int));
+   t->deps[t->ndeps++] = pred;
+}
+
+// Registers an access to a tile like the runtime does: reads depend on the last
+// writer, writes also on the readers since it
+static void access_tile(dag_t *g, const int id, const int tile, const int write)
+{
+   add_dep(g, g->writer[tile], id);
+   if (write) {
+      for (int r = 0; r < g->nreaders[tile]; r++) {
+         if (g->readers[tile][r] != id) add_dep(g, g->readers[tile][r], id);
+      }
+      g->nreaders[tile] = 0;
+      g->writer[tile] = id;
+   } else {
+      if (g->nreaders[tile] == g->rcap[tile]) {
+         g->rcap[tile] = g->rcap[tile] ? 2*g->rcap[tile] : 4;
+         g->readers[tile] = (int *)realloc(g->readers[tile], g->rcap[tile]*sizeof(int));
+      }
+      g->readers[tile][g->nreaders[tile]++] = id;
+   }
+}
+
+static int new_task(dag_t *g, const int kernel, const int i, const int j, const int k)
+{
+   if (g->ntasks == g->cap) {
+      g->cap = g->cap ? 2*g->cap : 1024;
+      g->tasks = (task_t *)realloc(g->tasks, g->cap*sizeof(task_t));
+   }
+   task_t *t = &g->tasks[g->ntasks];
+   memset(t, 0, sizeof(*t));
+   t->kernel = kernel;
+   t->i = i;
+   t->j = j;
+   t->k = k;
+   return g->ntasks++;
+}
+
+// Same task creation order and accesses as cholesky_blocked
+static void build_dag(dag_t *g, const int nt, const int la)
+{
+   const int ntiles = NUM_TILES(nt);
+   memset(g, 0, sizeof(*g));
+   g->writer = (int *)malloc(ntiles*sizeof(int));
+   g->nreaders = (int *)calloc(ntiles, sizeof(int));
+   g->rcap = (int *)calloc(ntiles, sizeof(int));
+   g->readers = (int **)calloc(ntiles, sizeof(int *));
+   for (int t = 0; t < ntiles; t++) {
+      g->writer[t] = -1;
+   }
+
+   for (int k = 0; k < nt + la; k++) {
+      if (k < nt) {
+         int id = new_task(g, K_POTRF, k, k, k);
+         access_tile(g, id, TILE_IDX(k, k), 1);
+         for (int i = k+1; i < nt; i++) {
+            id = new_task(g, K_TRSM, i, k, k);
+            access_tile(g, id, TILE_IDX(k, k), 0);
+            access_tile(g, id, TILE_IDX(i, k), 1);
+         }
+      }
+
+      for (int u = 0; u < 2; u++) {
+         const int p    = u == 0 ? k : k - la;
+         const int jend = u == 0 ? k + la : nt - 1;
+         if (p < 0 || p >= nt) continue;
+
+         for (int j = k + 1; j <= jend && j < nt; j++) {
+            int id = new_task(g, K_SYRK, j, j, p);
+            access_tile(g, id, TILE_IDX(j, p), 0);
+            access_tile(g, id, TILE_IDX(j, j), 1);
+            for (int i = j + 1; i < nt; i++) {
+               id = new_task(g, K_GEMM, i, j, p);
+               access_tile(g, id, TILE_IDX(i, p), 0);
+               access_tile(g, id, TILE_IDX(j, p), 0);
+               access_tile(g, id, TILE_IDX(i, j), 1);
+            }
+         }
+      }
+   }
+
+   // Successor lists
+   for (int t = 0; t < g->ntasks; t++) {
+      for (int d = 0; d < g->tasks[t].ndeps; d++) {
+         task_t *p = &g->tasks[g->tasks[t].deps[d]];
+         p->succ = (int *)realloc(p->succ, (p->nsucc + 1)*sizeof(int));
+         p->succ[p->nsucc++] = t;
+      }
+   }
+}
+
+static double kernel_flops(const int kernel, const double ts)
+{
+   switch (kernel) {
+      case K_POTRF: return ts*ts*ts/3;
+      case K_TRSM:  return ts*ts*ts;
+      case K_SYRK:  return ts*ts*(ts + 1);
+      default:      return 2*ts*ts*ts;
+   }
+}
+
+// Execution time of a kernel. FPGA kernels copy their tiles in and out
+// through the memory port and run the loops of cholesky.c at their II.
+static double kernel_cost(const config_t *c, const int kernel)
+{
+   const double ts = c->ts;
+   if (c->smp[kernel]) {
+      return kernel_flops(kernel, ts)/(c->smp_gflops*1e9) + c->overhead;
+   }
+
+   static const int tiles_in[K_NUM] = {1, 2, 2, 3};
+   const double copy = (tiles_in[kernel] + 1)*ts*ts*c->elem*8/c->port;
+   double comp;
+   switch (kernel) {
+      case K_POTRF: comp = ts*ts*ts/6 + ts*ts/2; break;            // pipelined dot products, II 1
+      case K_TRSM:  comp = ts*(ts + 1)/2*c->other_ii; break;         // row loop at II, columns unrolled
+      case K_SYRK:  comp = ts*(c->ts/2 + c->ts%2 + 1)*c->other_ii; break; // folded lower triangle, ts/2 iterations per k and the middle column of an odd ts
+      default:      comp = ts*ts*c->gemm_ii; break;
+   }
+   return (copy + comp + PIPE_DEPTH)/(c->clock*1e6) + c->overhead;
+}
+
+// Ready tasks of a kernel, ordered by ready time and creation order
+typedef struct {
+   int len, cap, *heap;
+} rqueue_t;
+
+static int rq_less(const task_t *T, const int a, const int b)
+{
+   return T[a].ready < T[b].ready || (T[a].ready == T[b].ready && a < b);
+}
+
+static void rq_push(rqueue_t *q, const task_t *T, const int id)
+{
+   if (q->len == q->cap) {
+      q->cap = q->cap ? 2*q->cap : 256;
+      q->heap = (int *)realloc(q->heap, q->cap*sizeof(int));
+   }
+   int p = q->len++;
+   while (p > 0 && rq_less(T, id, q->heap[(p - 1)/2])) {
+      q->heap[p] = q->heap[(p - 1)/2];
+      p = (p - 1)/2;
+   }
+   q->heap[p] = id;
+}
+
+static int rq_pop(rqueue_t *q, const task_t *T)
+{
+   const int top = q->heap[0], last = q->heap[--q->len];
+   int p = 0;
+   for (;;) {
+      int c = 2*p + 1;
+      if (c >= q->len) break;
+      if (c + 1 < q->len && rq_less(T, q->heap[c + 1], q->heap[c])) c++;
+      if (!rq_less(T, q->heap[c], last)) break;
+      q->heap[p] = q->heap[c];
+      p = c;
+   }
+   if (q->len > 0) q->heap[p] = last;
+   return top;
+}
+
+typedef struct {
+   double makespan;
+   double busy[K_NUM];   // accumulated execution time per kernel
+   int count[K_NUM];
+   double cpath;         // critical path length (secs)
+   int cpath_count[K_NUM];
+} result_t;
+
+// Greedy list scheduling: the task that can start first runs on the first free unit of its kernel
+static void simulate(dag_t *g, const config_t *c, result_t *res)
+{
+   task_t * const T = g->tasks;
+   int *pending = (int *)malloc(g->ntasks*sizeof(int));
+   double free_at[K_NUM][MAX_UNITS];
+   rqueue_t rq[K_NUM];
+
+   memset(res, 0, sizeof(*res));
+   memset(rq, 0, sizeof(rq));
+   for (int k = 0; k < K_NUM; k++) {
+      for (int u = 0; u < c->units[k]; u++) free_at[k][u] = 0;
+   }
+   for (int t = 0; t < g->ntasks; t++) {
+      T[t].cost = kernel_cost(c, T[t].kernel);
+      T[t].ready = 0;
+      pending[t] = T[t].ndeps;
+      if (pending[t] == 0) rq_push(&rq[T[t].kernel], T, t);
+   }
+
+   for (int done = 0; done < g->ntasks; done++) {
+      int best = -1, bunit = 0;
+      double bstart = 0;
+      for (int k = 0; k < K_NUM; k++) {
+         if (rq[k].len == 0) continue;
+         int u = 0;
+         for (int v = 1; v < c->units[k]; v++) {
+            if (free_at[k][v] < free_at[k][u]) u = v;
+         }
+         const double ready = T[rq[k].heap[0]].ready;
+         const double start = ready > free_at[k][u] ? ready : free_at[k][u];
+         if (best < 0 || start < bstart) {
+            best = k;
+            bunit = u;
+            bstart = start;
+         }
+      }
+      assert(best >= 0);
+
+      const int t = rq_pop(&rq[best], T);
+      T[t].start = bstart;
+      T[t].end = bstart + T[t].cost;
+      T[t].unit = bunit;
+      free_at[best][bunit] = T[t].end;
+      res->busy[best] += T[t].cost;
+      res->count[best]++;
+      res->makespan = T[t].end > res->makespan ? T[t].end : res->makespan;
+      for (int s = 0; s < T[t].nsucc; s++) {
+         const int n = T[t].succ[s];
+         T[n].ready = T[t].end > T[n].ready ? T[t].end : T[n].ready;
+         if (--pending[n] == 0) rq_push(&rq[T[n].kernel], T, n);
+      }
+   }
+
+   // Critical path, the longest path with the task costs (tasks are created in topological order)
+   double *len = (double *)malloc(g->ntasks*sizeof(double));
+   int *prev = (int *)malloc(g->ntasks*sizeof(int));
+   int last = 0;
+   for (int t = 0; t < g->ntasks; t++) {
+      len[t] = 0;
+      prev[t] = -1;
+      for (int d = 0; d < T[t].ndeps; d++) {
+         if (len[T[t].deps[d]] > len[t]) {
+            len[t] = len[T[t].deps[d]];
+            prev[t] = T[t].deps[d];
+         }
+      }
+      len[t] += T[t].cost;
+      if (len[t] > len[last]) last = t;
+   }
+   res->cpath = g->ntasks > 0 ? len[last] : 0;
+   for (int t = g->ntasks > 0 ? last : -1; t >= 0; t = prev[t]) {
+      res->cpath_count[T[t].kernel]++;
+   }
+
+   for (int k = 0; k < K_NUM; k++) free(rq[k].heap);
+   free(prev);
+   free(len);
+   free(pending);
+}
+
+static void export_dot(const dag_t *g, const char *fname)
+{
+   static const char * const colors[K_NUM] = {"red", "orange", "lightblue", "lightgreen"};
+   FILE *f = fopen(fname, "w");
+   if (f == NULL) {
+      fprintf(stderr, "ERROR:\tCannot open '%s'\n", fname);
+      exit(1);
+   }
+   fprintf(f, "digraph cholesky {\n");
+   for (int t = 0; t < g->ntasks; t++) {
+      const task_t *T = &g->tasks[t];
+      fprintf(f, "  t%d [label=\"%s %d,%d,%d\", style=filled, fillcolor=%s];\n",
+         t, knames[T->kernel], T->i, T->j, T->k, colors[T->kernel]);
+      for (int d = 0; d < T->ndeps; d++) {
+         fprintf(f, "  t%d -> t%d;\n", T->deps[d], t);
+      }
+   }
+   fprintf(f, "}\n");
+   fclose(f);
+}
+
+static void export_json(const dag_t *g, const config_t *c, const int nt, const result_t *res, const char *fname)
+{
+   FILE *f = fopen(fname, "w");
+   if (f == NULL) {
+      fprintf(stderr, "ERROR:\tCannot open '%s'\n", fname);
+      exit(1);
+   }
+   fprintf(f, "{\n  \"nt\": %d, \"ts\": %d, \"lookahead\": %d, \"makespan\": %e, \"critical_path\": %e,\n",
+      nt, c->ts, c->la, res->makespan, res->cpath);
+   fprintf(f, "  \"tasks\": [\n");
+   for (int t = 0; t < g->ntasks; t++) {
+      const task_t *T = &g->tasks[t];
+      fprintf(f, "    {\"id\": %d, \"kernel\": \"%s\", \"i\": %d, \"j\": %d, \"k\": %d, \"cost\": %e, "
+         "\"start\": %e, \"end\": %e, \"unit\": %d, \"deps\": [",
+         t, knames[T->kernel], T->i, T->j, T->k, T->cost, T->start, T->end, T->unit);
+      for (int d = 0; d < T->ndeps; d++) {
+         fprintf(f, d ? ", %d" : "%d", T->deps[d]);
+      }
+      fprintf(f, "]}%s\n", t + 1 < g->ntasks ? "," : "");
+   }
+   fprintf(f, "  ]\n}\n");
+   fclose(f);
+}
+
+// Takes the accelerator counts from the number of instances listed per kernel in a placement file
+static void read_placement(const char *fname, config_t *c)
+{
+   static const char * const keys[K_NUM] = {"\"omp_potrf\"", "\"omp_trsm\"", "\"omp_syrk\"", "\"omp_gemm\""};
+   FILE *f = fopen(fname, "r");
+   char buf[8192];
+   size_t len;
+
+   if (f == NULL) {
+      fprintf(stderr, "ERROR:\tCannot open '%s'\n", fname);
+      exit(1);
+   }
+   len = fread(buf, 1, sizeof(buf) - 1, f);
+   buf[len] = '\0';
+   fclose(f);
+
+   for (int k = 0; k < K_NUM; k++) {
+      const char *p = strstr(buf, keys[k]);
+      if (p == NULL || c->smp[k]) continue;
+      p = strchr(p, '[');
+      if (p == NULL) continue;
+      int n = 0, num = 0;
+      for (p++; *p && *p != ']'; p++) {
+         if (*p >= '0' && *p <= '9') {
+            if (!num) n++;
+            num = 1;
+         } else {
+            num = 0;
+         }
+      }
+      c->units[k] = n;
+   }
+}
+
+static void print_result(const config_t *c, const int nt, const result_t *res)
+{
+   const double n = (double)nt*c->ts;
+   printf("  Makespan (secs):       %e\n", res->makespan);
+   printf("  Performance (GFLOPS):  %f\n", n*n*n/3/res->makespan/1e9);
+   printf("  Critical path (secs):  %e (%d potrf, %d trsm, %d syrk, %d gemm)\n", res->cpath,
+      res->cpath_count[K_POTRF], res->cpath_count[K_TRSM], res->cpath_count[K_SYRK], res->cpath_count[K_GEMM]);
+   for (int k = 0; k < K_NUM; k++) {
+      printf("  %-5s %s x%-2d  tasks %8d  task time %e  utilization %5.1f%%\n", knames[k],
+         c->smp[k] ? "smp" : "acc", c->units[k], res->count[k], kernel_cost(c, k),
+         100*res->busy[k]/(c->units[k]*res->makespan));
+   }
+}
+
+typedef struct {
+   int syrk, gemm, trsm;
+   double makespan;
+} sweep_t;
+
+static int cmp_sweep(const void *a, const void *b)
+{
+   const double x = ((const sweep_t *)a)->makespan, y = ((const sweep_t *)b)->makespan;
+   return (x > y) - (x < y);
+}
+
+static void usage(const char *prog)
+{
+   fprintf(stderr, "USAGE:\t%s [-b <block size>] [-l <lookahead>] [-D] [-f <clock MHz>] [-w <port width>]\n"
+      "\t[-g <gemm II>] [-i <other II>] [-S <syrk accs>] [-G <gemm accs>] [-T <trsm accs>] [-a <placement file>]\n"
+      "\t[-P <potrf cores, 0 for FPGA>] [-R <trsm cores, 0 for FPGA>] [-c <core GFLOPS>] [-O <task overhead us>]\n"
+      "\t[-x <max accs>] [-d <dot file>] [-j <json file>] <num tiles>\n", prog);
+   exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+   config_t c;
+   const char *dot = NULL, *json = NULL, *placement = NULL;
+   int sweep = 0; // rank every accelerator mix up to this number of accelerators
+   int opt;
+
+   c.ts = BLOCK_SIZE;
+   c.la = 1;
+#ifdef USE_DOUBLE
+   c.elem = 8;
+#else
+   c.elem = 4;
+#endif
+   c.clock = FPGA_CLOCK;
+   c.port = FPGA_MEMORY_PORT_WIDTH;
+   c.gemm_ii = FPGA_GEMM_LOOP_II;
+   c.other_ii = FPGA_OTHER_LOOP_II;
+   c.units[K_POTRF] = POTRF_CORES > 0 ? POTRF_CORES : 1;
+   c.units[K_TRSM] = TRSM_NUM_ACCS;
+   c.units[K_SYRK] = SYRK_NUM_ACCS;
+   c.units[K_GEMM] = GEMM_NUM_ACCS;
+   c.smp[K_POTRF] = POTRF_CORES > 0;
+   c.smp[K_TRSM] = c.smp[K_SYRK] = c.smp[K_GEMM] = 0;
+   c.smp_gflops = 2;
+   c.overhead = 1e-6;
+
+   while ((opt = getopt(argc, argv, "b:l:Df:w:g:i:S:G:T:a:P:R:c:O:x:d:j:")) != -1) {
+      switch (opt) {
+         case 'b': c.ts = atoi(optarg); break;
+         case 'l': c.la = atoi(optarg); break;
+         case 'D': c.elem = 8; break;
+         case 'f': c.clock = atof(optarg); break;
+         case 'w': c.port = atoi(optarg); break;
+         case 'g': c.gemm_ii = atoi(optarg); break;
+         case 'i': c.other_ii = atoi(optarg); break;
+         case 'S': c.units[K_SYRK] = atoi(optarg); break;
+         case 'G': c.units[K_GEMM] = atoi(optarg); break;
+         case 'T': c.units[K_TRSM] = atoi(optarg); c.smp[K_TRSM] = 0; break;
+         case 'a': placement = optarg; break;
+         case 'P':
+            c.smp[K_POTRF] = atoi(optarg) > 0;
+            c.units[K_POTRF] = c.smp[K_POTRF] ? atoi(optarg) : 1;
+            break;
+         case 'R':
+            c.smp[K_TRSM] = atoi(optarg) > 0;
+            c.units[K_TRSM] = c.smp[K_TRSM] ? atoi(optarg) : TRSM_NUM_ACCS;
+            break;
+         case 'c': c.smp_gflops = atof(optarg); break;
+         case 'O': c.overhead = atof(optarg)*1e-6; break;
+         case 'x': sweep = atoi(optarg); break;
+         case 'd': dot = optarg; break;
+         case 'j': json = optarg; break;
+         default: usage(argv[0]);
+      }
+   }
+   if (argc - optind < 1) usage(argv[0]);
+   const int nt = atoi(argv[optind]);
+   if (placement != NULL) read_placement(placement, &c);
+   for (int k = 0; k < K_NUM; k++) {
+      if (c.units[k] < 1 || c.units[k] > MAX_UNITS) {
+         fprintf(stderr, "ERROR:\tThe %s units must be between 1 and %d\n", knames[k], MAX_UNITS);
+         exit(1);
+      }
+   }
+   if (nt < 1 || c.ts < 1 || c.la < 0 || c.port < 8 || c.clock <= 0 || c.smp_gflops <= 0 || sweep > MAX_UNITS) {
+      fprintf(stderr, "ERROR:\tInvalid parameters\n");
+      exit(1);
+   }
+
+   dag_t g;
+   result_t res;
+   build_dag(&g, nt, c.la);
+
+   printf("==================== DAGSIM ====================== \n");
+   printf("  Matrix: %dx%d tiles of %dx%d (%d bytes elements), lookahead %d, %d tasks\n",
+      nt, nt, c.ts, c.ts, c.elem, c.la, g.ntasks);
+   printf("  Accelerators at %.0f MHz, %d bits port, gemm II %d, other II %d\n",
+      c.clock, c.port, c.gemm_ii, c.other_ii);
+
+   if (sweep > 0) {
+      // Every mix of at least one syrk, gemm and trsm accelerator up to sweep accelerators
+      sweep_t *mix = (sweep_t *)malloc(sweep*sweep*sweep*sizeof(sweep_t));
+      int nmix = 0;
+      const int trsm_max = c.smp[K_TRSM] ? 1 : sweep;
+      for (int s = 1; s <= sweep; s++) {
+         for (int t = 1; t <= trsm_max; t++) {
+            for (int m = 1; s + m + (c.smp[K_TRSM] ? 0 : t) <= sweep; m++) {
+               c.units[K_SYRK] = s;
+               c.units[K_GEMM] = m;
+               if (!c.smp[K_TRSM]) c.units[K_TRSM] = t;
+               simulate(&g, &c, &res);
+               mix[nmix].syrk = s;
+               mix[nmix].gemm = m;
+               mix[nmix].trsm = c.units[K_TRSM];
+               mix[nmix].makespan = res.makespan;
+               nmix++;
+            }
+         }
+      }
+      qsort(mix, nmix, sizeof(sweep_t), cmp_sweep);
+      const double n = (double)nt*c.ts;
+      printf("  Rank  syrk  gemm  trsm  makespan (secs)  GFLOPS\n");
+      for (int r = 0; r < nmix; r++) {
+         printf("  %4d  %4d  %4d  %4d  %e  %f\n", r + 1, mix[r].syrk, mix[r].gemm, mix[r].trsm,
+            mix[r].makespan, n*n*n/3/mix[r].makespan/1e9);
+      }
+      free(mix);
+   } else {
+      simulate(&g, &c, &res);
+      print_result(&c, nt, &res);
+      if (json != NULL) export_json(&g, &c, nt, &res, json);
+   }
+   printf("================================================== \n");
+   if (dot != NULL) export_dot(&g, dot);
+
+   return 0;
+}
@@ -0,0 +1,247 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cholesky.h"
+#include "kstats.h"
+
+// Kernel samples beyond this per kernel are counted but not timed
+#define KSTATS_MAX_SAMPLES (1 << 20)
+
+typedef struct {
+   double t0, t1; // start and end of the kernel
+   int run;       // measured run it belongs to
+} kstats_sample_t;
+
+typedef struct {
+   uint64_t count;     // kernel calls
+   uint64_t capacity;  // allocated samples
+   uint64_t recorded;  // calls with a timed sample
+   kstats_sample_t *samples;
+} kstats_kernel_t;
+
+static const char * const kstats_names[KS_NUM] = {"potrf", "trsm", "syrk", "gemm"};
+static kstats_kernel_t kstats[KS_NUM];
+static volatile int kstats_on = 0;   // record the kernels?
+static int kstats_run = 0;           // current measured run
+static double kstats_t0, kstats_time = 0; // start of the current run and total measured time
+
+// Flops of one kernel call on ts x ts tiles
+static double kstats_flops(const int kernel, const int ts)
+{
+   const double t = ts;
+   switch (kernel) {
+      case KS_POTRF: return t*t*t/3;
+      case KS_TRSM:  return t*t*t;
+      case KS_SYRK:  return t*t*(t + 1);
+      default:       return 2*t*t*t;
+   }
+}
+
+void kstats_init(const uint64_t capacity[KS_NUM])
+{
+   for (int k = 0; k < KS_NUM; k++) {
+      kstats[k].count = kstats[k].recorded = 0;
+      kstats[k].capacity = capacity[k] < KSTATS_MAX_SAMPLES ? capacity[k] : KSTATS_MAX_SAMPLES;
+      kstats[k].samples = (kstats_sample_t *)malloc(kstats[k].capacity*sizeof(kstats_sample_t));
+      if (kstats[k].samples == NULL) kstats[k].capacity = 0;
+   }
+}
+
+// Only the kernels between kstats_start and kstats_stop, where no other tasks are running, are recorded
+void kstats_start(void)
+{
+   kstats_run++;
+   kstats_t0 = wall_time();
+   kstats_on = 1;
+}
+
+void kstats_stop(void)
+{
+   kstats_on = 0;
+   kstats_time += wall_time() - kstats_t0;
+}
+
+void kstats_record(const int kernel, const double t0, const double t1)
+{
+   if (!kstats_on) return;
+
+   kstats_kernel_t * const ks = &kstats[kernel];
+   const uint64_t idx = __atomic_fetch_add(&ks->count, 1, __ATOMIC_RELAXED);
+   if (idx < ks->capacity) {
+      ks->samples[idx].t0 = t0;
+      ks->samples[idx].t1 = t1;
+      ks->samples[idx].run = kstats_run;
+      __atomic_fetch_add(&ks->recorded, 1, __ATOMIC_RELAXED);
+   }
+}
+
+// Records a task that applies n calls of a kernel, as n calls of the same length
+void kstats_record_n(const int kernel, const int n, const double t0, const double t1)
+{
+   const double d = (t1 - t0)/n;
+
+   for (int c = 0; c < n; c++) {
+      kstats_record(kernel, t0 + c*d, t0 + (c + 1)*d);
+   }
+}
+
+// Counts calls of a kernel that runs outside the host, so it cannot be timed
+void kstats_add_count(const int kernel, const uint64_t count)
+{
+   kstats[kernel].count += count;
+}
+
+static int kstats_cmp_double(const void *a, const void *b)
+{
+   const double x = *(const double *)a, y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+static int kstats_cmp_sample(const void *a, const void *b)
+{
+   const kstats_sample_t *x = (const kstats_sample_t *)a, *y = (const kstats_sample_t *)b;
+   if (x->run != y->run) return x->run - y->run;
+   return (x->t0 > y->t0) - (x->t0 < y->t0);
+}
+
+typedef struct {
+   uint64_t count, recorded;
+   double total, min, p50, p90, p99, max; // latencies (secs)
+   double gflops;                         // flops over the time spent in the kernel
+} kstats_summary_t;
+
+static void kstats_summarize(const int kernel, const int ts, kstats_summary_t *s)
+{
+   const kstats_kernel_t * const ks = &kstats[kernel];
+   const uint64_t len = ks->recorded;
+
+   memset(s, 0, sizeof(*s));
+   s->count = ks->count;
+   s->recorded = len;
+   if (len == 0) {
+      // Not timed, rate over the whole measured time
+      s->gflops = kstats_time > 0 ? ks->count*kstats_flops(kernel, ts)/kstats_time/1e9 : 0;
+      return;
+   }
+
+   double *lat = (double *)malloc(len*sizeof(double));
+   for (uint64_t i = 0; i < len; i++) {
+      lat[i] = ks->samples[i].t1 - ks->samples[i].t0;
+      s->total += lat[i];
+   }
+   qsort(lat, len, sizeof(double), kstats_cmp_double);
+   s->min = lat[0];
+   s->p50 = lat[(len - 1)/2];
+   s->p90 = lat[(uint64_t)(0.90*(len - 1))];
+   s->p99 = lat[(uint64_t)(0.99*(len - 1))];
+   s->max = lat[len - 1];
+   s->gflops = s->total > 0 ? len*kstats_flops(kernel, ts)/s->total/1e9 : 0;
+   free(lat);
+}
+
+// The potrf tasks are the critical path of the factorization, so the time
+// between the end of a potrf and the start of the next one of the same run
+// is time the critical path spent waiting for updates or for a worker
+static void kstats_potrf_gaps(uint64_t *count, double *total, double *max)
+{
+   kstats_kernel_t * const ks = &kstats[KS_POTRF];
+
+   *count = 0;
+   *total = *max = 0;
+   qsort(ks->samples, ks->recorded, sizeof(kstats_sample_t), kstats_cmp_sample);
+   for (uint64_t i = 1; i < ks->recorded; i++) {
+      if (ks->samples[i].run != ks->samples[i - 1].run) continue;
+      const double gap = ks->samples[i].t0 - ks->samples[i - 1].t1;
+      if (gap <= 0) continue;
+      (*count)++;
+      *total += gap;
+      *max = gap > *max ? gap : *max;
+   }
+}
+
+void kstats_print(const int ts)
+{
+   kstats_summary_t s;
+   uint64_t gcount;
+   double gtotal, gmax;
+
+   printf( "================== KERNEL STATS ================== \n" );
+   printf( "  %-6s %10s %11s %11s %11s %11s %9s\n", "kernel", "calls", "total(s)", "p50(us)", "p99(us)", "max(us)", "GFLOPS" );
+   for (int k = 0; k < KS_NUM; k++) {
+      kstats_summarize(k, ts, &s);
+      if (s.recorded > 0) {
+         printf( "  %-6s %10llu %11f %11.2f %11.2f %11.2f %9.3f\n", kstats_names[k], (unsigned long long)s.count,
+            s.total, s.p50*1e6, s.p99*1e6, s.max*1e6, s.gflops );
+      } else {
+         printf( "  %-6s %10llu %11s %11s %11s %11s %9.3f\n", kstats_names[k], (unsigned long long)s.count,
+            "-", "-", "-", "-", s.gflops );
+      }
+   }
+   kstats_potrf_gaps(&gcount, &gtotal, &gmax);
+   printf( "  Critical path gaps: %llu, total %f secs (%.1f%%), max %f secs\n", (unsigned long long)gcount,
+      gtotal, kstats_time > 0 ? 100*gtotal/kstats_time : 0, gmax );
+}
+
+// Returns the stats as a JSON object, to be freed by the caller
+char *kstats_json(const int ts)
+{
+   char *buf = NULL;
+   size_t len = 0;
+   FILE *f = open_memstream(&buf, &len);
+   kstats_summary_t s;
+   uint64_t gcount;
+   double gtotal, gmax;
+
+   if (f == NULL) return NULL;
+   fprintf(f, "{");
+   for (int k = 0; k < KS_NUM; k++) {
+      kstats_summarize(k, ts, &s);
+      fprintf(f, "\"%s\": {\"calls\": %llu, \"timed\": %llu, \"total\": %f, \"min\": %e, \"p50\": %e, "
+         "\"p90\": %e, \"p99\": %e, \"max\": %e, \"gflops\": %f}, ",
+         kstats_names[k], (unsigned long long)s.count, (unsigned long long)s.recorded,
+         s.total, s.min, s.p50, s.p90, s.p99, s.max, s.gflops);
+   }
+   kstats_potrf_gaps(&gcount, &gtotal, &gmax);
+   fprintf(f, "\"critical_path\": {\"gaps\": %llu, \"total\": %f, \"max\": %f, \"fraction\": %f}}",
+      (unsigned long long)gcount, gtotal, gmax, kstats_time > 0 ? gtotal/kstats_time : 0);
+   fclose(f);
+
+   return buf;
+}
+
+void kstats_free(void)
+{
+   for (int k = 0; k < KS_NUM; k++) {
+      free(kstats[k].samples);
+      kstats[k].samples = NULL;
+      kstats[k].capacity = 0;
+   }
+}
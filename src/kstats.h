@@ -0,0 +1,59 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __KSTATS_H__
+#define __KSTATS_H__
+
+#include <stdint.h>
+
+// Lightweight per-kernel counters, compiled in with KERNEL_STATS. SMP kernel
+// tasks record their start and end times, kernels that run on the FPGA are
+// only counted, from the number of tasks the factorization creates.
+
+enum { KS_POTRF, KS_TRSM, KS_SYRK, KS_GEMM, KS_NUM };
+
+#ifdef KERNEL_STATS
+#  define KSTATS_BEGIN()  const double kstats_t0 = wall_time()
+#  define KSTATS_END(k)   kstats_record((k), kstats_t0, wall_time())
+#  define KSTATS_END_N(k, n) kstats_record_n((k), (n), kstats_t0, wall_time())
+#else
+#  define KSTATS_BEGIN()
+#  define KSTATS_END(k)
+#  define KSTATS_END_N(k, n)
+#endif
+
+void kstats_init(const uint64_t capacity[KS_NUM]);
+void kstats_start(void);
+void kstats_stop(void);
+void kstats_record(const int kernel, const double t0, const double t1);
+void kstats_record_n(const int kernel, const int n, const double t0, const double t1);
+void kstats_add_count(const int kernel, const uint64_t count);
+void kstats_print(const int ts);
+char *kstats_json(const int ts);
+void kstats_free(void);
+
+#endif //__KSTATS_H__
@@ -0,0 +1,156 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cholesky.h"
+#include "libcholesky.h"
+
+#define LIB_LOOKAHEAD 1 // lookahead depth of cholesky_blocked
+
+// Element (r,c), r >= c, of the lower factor is at A[c*ld + r], or at
+// A[r*ld + c] when the triangle is stored transposed (row-major lower or
+// column-major upper)
+#define LIN_IDX(r, c, ld, trans) ((trans) ? (size_t)(r)*(ld) + (c) : (size_t)(c)*(ld) + (r))
+
+// Copies tile (i,j) of the linear matrix to A. Diagonal tiles only get their
+// lower triangle, and the padding past n is filled with the identity.
+#pragma oss task out([ts*ts]A)
+void gather_tile(const int n, const int ld, const int trans, const int i, const int j,
+   const type_t *Alin, type_t *A)
+{
+   for (int c = 0; c < ts; c++) {
+      const int C = j*ts + c;
+      for (int r = 0; r < ts; r++) {
+         const int R = i*ts + r;
+         if (R >= n || C >= n || (i == j && r < c)) {
+            A[c*ts + r] = R == C ? 1 : 0;
+         } else {
+            A[c*ts + r] = Alin[LIN_IDX(R, C, ld, trans)];
+         }
+      }
+   }
+}
+
+// Copies tile (i,j) back to the linear matrix, the inverse of gather_tile
+#pragma oss task in([ts*ts]A)
+void scatter_tile(const int n, const int ld, const int trans, const int i, const int j,
+   const type_t *A, type_t *Alin)
+{
+   for (int c = 0; c < ts && j*ts + c < n; c++) {
+      for (int r = i == j ? c : 0; r < ts && i*ts + r < n; r++) {
+         Alin[LIN_IDX(i*ts + r, j*ts + c, ld, trans)] = A[c*ts + r];
+      }
+   }
+}
+
+int chol_elem_size(void)
+{
+   return sizeof(type_t);
+}
+
+int chol_tile_size(void)
+{
+   return ts;
+}
+
+int chol_factorize(int n, void *A, int ld, chol_order_t order, chol_uplo_t uplo, chol_status_t *status)
+{
+   chol_status_t st;
+   memset(&st, 0, sizeof(st));
+   st.tile_size = ts;
+
+   const double tIni = wall_time();
+
+   if (n < 0) {
+      st.info = -1;
+   } else if (A == NULL && n > 0) {
+      st.info = -2;
+   } else if (order != CHOL_TILED && ld < (n > 1 ? n : 1)) {
+      st.info = -3;
+   } else if (order != CHOL_COL_MAJOR && order != CHOL_ROW_MAJOR && order != CHOL_TILED) {
+      st.info = -4;
+   } else if ((uplo != CHOL_LOWER && uplo != CHOL_UPPER) || (order == CHOL_TILED && uplo != CHOL_LOWER)) {
+      st.info = -5;
+   } else if (order == CHOL_TILED && n % ts != 0) {
+      st.info = -1;
+   }
+   if (st.info != 0 || n == 0) {
+      if (status != NULL) *status = st;
+      return st.info;
+   }
+
+   const int nt = (n + ts - 1)/ts;
+   const int trans = (order == CHOL_COL_MAJOR) != (uplo == CHOL_LOWER);
+   type_t *Ab = (type_t *)A;
+
+   if (order != CHOL_TILED) {
+      Ab = (type_t *)malloc(NUM_TILES(nt)*ts*ts*sizeof(type_t));
+      if (Ab == NULL) {
+         st.info = CHOL_ERR_NOMEM;
+         if (status != NULL) *status = st;
+         return st.info;
+      }
+      for (int i = 0; i < nt; i++) {
+         for (int j = 0; j <= i; j++) {
+            gather_tile(n, ld, trans, i, j, (const type_t *)A, Ab + TILE_IDX(i, j)*ts*ts);
+         }
+      }
+      #pragma oss taskwait
+   }
+   const double tFactor = wall_time();
+
+   cholesky_blocked_sync(nt, LIB_LOOKAHEAD, Ab);
+   const double tToLinear = wall_time();
+
+   // Same convention as potrf, the first non positive pivot
+   for (int d = 0; d < n && st.info == 0; d++) {
+      const type_t v = Ab[TILE_IDX(d/ts, d/ts)*ts*ts + (d%ts)*ts + d%ts];
+      if (!(v > 0)) st.info = d + 1;
+   }
+
+   if (order != CHOL_TILED) {
+      for (int i = 0; i < nt; i++) {
+         for (int j = 0; j <= i; j++) {
+            scatter_tile(n, ld, trans, i, j, Ab + TILE_IDX(i, j)*ts*ts, (type_t *)A);
+         }
+      }
+      #pragma oss taskwait
+      free(Ab);
+   }
+   const double tEnd = wall_time();
+
+   st.to_tiles_time = tFactor - tIni;
+   st.factor_time = tToLinear - tFactor;
+   st.to_linear_time = tEnd - tToLinear;
+   st.total_time = tEnd - tIni;
+   st.gflops = st.factor_time > 0 ? (double)n*n*n/3.0/st.factor_time/1e9 : 0;
+
+   if (status != NULL) *status = st;
+   return st.info;
+}
@@ -0,0 +1,81 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __LIBCHOLESKY_H__
+#define __LIBCHOLESKY_H__
+
+// Public interface of libcholesky. The element type (float or double), the
+// tile size and the FPGA accelerators are fixed when the library is built,
+// use chol_elem_size and chol_tile_size to query them.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Storage of the matrix passed to chol_factorize
+typedef enum {
+   CHOL_COL_MAJOR, // linear matrix, column-major with leading dimension ld
+   CHOL_ROW_MAJOR, // linear matrix, row-major with leading dimension ld
+   CHOL_TILED      // packed lower triangle of tiles of the benchmark layout, factorized without copies
+} chol_order_t;
+
+// Triangle of the matrix that is read and overwritten with the factor
+typedef enum {
+   CHOL_LOWER,     // A = L*L'
+   CHOL_UPPER      // A = U'*U
+} chol_uplo_t;
+
+#define CHOL_ERR_NOMEM (-100) // the tiled copy of a linear matrix could not be allocated
+
+// Outcome of a factorization
+typedef struct {
+   int info;              // 0 on success, -i if argument i is wrong, i > 0 if the minor of order i is not positive definite
+   int tile_size;         // tile size used
+   double to_tiles_time;  // linear to tiled conversion time (secs), 0 for CHOL_TILED
+   double factor_time;    // factorization time (secs)
+   double to_linear_time; // tiled to linear conversion time (secs), 0 for CHOL_TILED
+   double total_time;     // whole call time (secs)
+   double gflops;         // factorization performance, n^3/3 flops over factor_time
+} chol_status_t;
+
+// Size in bytes of the matrix elements
+int chol_elem_size(void);
+
+// Tile size of the CHOL_TILED layout
+int chol_tile_size(void);
+
+// Factorizes the n x n SPD matrix A in place, only the uplo triangle is read
+// and written. Linear matrices of any size are converted to tiles and back,
+// CHOL_TILED matrices must have a size multiple of the tile size and be
+// CHOL_LOWER, and ld is ignored for them. Returns status.info, status may be NULL.
+int chol_factorize(int n, void *A, int ld, chol_order_t order, chol_uplo_t uplo, chol_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__LIBCHOLESKY_H__
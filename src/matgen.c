@@ -0,0 +1,242 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cholesky.h"
+
+// The matrix is generated with the LAPACK xLARUV multiplicative congruential
+// generator, x(k+1) = a*x(k) mod 2^48, the one used by larnv. Element p of the
+// sequence only depends on a^p, so any tile can be (re)generated on its own.
+#define GEN_MASK ((UINT64_C(1) << 48) - 1)
+#define GEN_MULT ((UINT64_C(494) << 36) | (UINT64_C(322) << 24) | (UINT64_C(2508) << 12) | UINT64_C(2549))
+
+static uint64_t gen_pow(uint64_t a, uint64_t e)
+{
+   uint64_t r = 1;
+
+   for (; e; e >>= 1, a = (a*a) & GEN_MASK) {
+      if (e & 1) r = (r*a) & GEN_MASK;
+   }
+
+   return r;
+}
+
+// Same conversion as xLARUV, computed in the precision of T
+#define DEFINE_GEN_VALUE(name, T) \
+static inline T name(const uint64_t x) \
+{ \
+   const T r = 1.0/4096.0; \
+   T v = r*((T)(x >> 36) + r*((T)((x >> 24) & 4095) + \
+      r*((T)((x >> 12) & 4095) + r*(T)(x & 4095)))); \
+   /*NOTE: xLARUV reseeds when the value rounds to 1, we just keep it below 1*/ \
+   return v < 1 ? v : 1 - r*r*r*r; \
+}
+
+DEFINE_GEN_VALUE(gen_value, type_t)
+DEFINE_GEN_VALUE(gen_value_d, double)
+
+uint64_t gen_seed(const int iseed[4])
+{
+   return (((uint64_t)iseed[0] << 36) | ((uint64_t)iseed[1] << 24) |
+      ((uint64_t)iseed[2] << 12) | (uint64_t)iseed[3]) & GEN_MASK;
+}
+
+uint64_t gen_jump(const uint64_t seed, const uint64_t count)
+{
+   return (seed*gen_pow(GEN_MULT, count)) & GEN_MASK;
+}
+
+// Loaded matrix whose tiles gen_tile returns instead of generating them, with
+// gen_source_nt < 0 for packed lower tiles or the tiles per row otherwise
+static const type_t *gen_source = NULL;
+static int gen_source_nt;
+// Nonzero tiles of a tile-sparse matrix, in the order of the blocked matrix.
+// The other tiles of the generated matrix are zero
+static const char *gen_mask = NULL;
+// Low-rank correction added to every tile, A + V*V' or A - V*V' if gen_lowrank_down.
+// V holds n x gen_lowrank_k elements by row tiles of ts x gen_lowrank_k elements
+static const type_t *gen_lowrank_v = NULL;
+static int gen_lowrank_k, gen_lowrank_down;
+
+void gen_set_source(const type_t *A, const int nt, const int lower)
+{
+   gen_source = A;
+   gen_source_nt = lower ? -1 : nt;
+}
+
+void gen_set_mask(const char *nz)
+{
+   gen_mask = nz;
+}
+
+void gen_set_lowrank(const int nk, const int down, const type_t *V)
+{
+   gen_lowrank_v = nk > 0 ? V : NULL;
+   gen_lowrank_k = nk;
+   gen_lowrank_down = down;
+}
+
+// Generates the bs x bs block (i,j) of the n x n SPD matrix that results from
+// filling the matrix column by column with larnv(1, seed) and making it
+// diagonally dominant. The block is stored with leading dimension ld.
+// The same matrix can be generated in the precision of type_t or in double.
+#define DEFINE_GEN_TILE(name, T, value) \
+static void name##_bs(const int n, const uint64_t seed, const int i, const int j, \
+   const int bs, const int ld, T *A) \
+{ \
+   const uint64_t an = gen_pow(GEN_MULT, n); \
+   /* Element (r,c) is the (c*n + r + 1)-th number of the sequence */ \
+   uint64_t xcol = (seed*gen_pow(GEN_MULT, (uint64_t)(j*bs)*n + i*bs + 1)) & GEN_MASK; \
+   uint64_t xrow = (seed*gen_pow(GEN_MULT, (uint64_t)(i*bs)*n + j*bs + 1)) & GEN_MASK; \
+ \
+   for (int c = 0; c < bs; c++) { \
+      uint64_t x = xcol, y = xrow; \
+      for (int r = 0; r < bs; r++) { \
+         const T s = value(x) + value(y); \
+         /*NOTE: Off-diagonal elements are symmetrized twice by the original algorithm*/ \
+         A[c*ld + r] = (i == j && r == c) ? s : s + s; \
+         x = (x*GEN_MULT) & GEN_MASK; \
+         y = (y*an) & GEN_MASK; \
+      } \
+      xcol = (xcol*an) & GEN_MASK; \
+      xrow = (xrow*GEN_MULT) & GEN_MASK; \
+   } \
+ \
+   if (i == j) { \
+      for (int d = 0; d < bs; d++) { \
+         A[d*ld + d] += (T)n; \
+      } \
+   } \
+} \
+ \
+void name(const int n, const uint64_t seed, const int i, const int j, T *A) \
+{ \
+   if (gen_mask != NULL && !gen_mask[TILE_IDX(i, j)]) { \
+      for (int e = 0; e < ts*ts; e++) { \
+         A[e] = 0; \
+      } \
+   } else if (gen_source != NULL) { \
+      const type_t *S = gen_source + (gen_source_nt < 0 ? TILE_IDX(i, j) : \
+         (size_t)i*gen_source_nt + j)*ts*ts; \
+      for (int e = 0; e < ts*ts; e++) { \
+         A[e] = S[e]; \
+      } \
+   } else { \
+      name##_bs(n, seed, i, j, ts, ts, A); \
+   } \
+   if (gen_lowrank_v != NULL) { \
+      const type_t *Vi = gen_lowrank_v + (size_t)i*ts*gen_lowrank_k; \
+      const type_t *Vj = gen_lowrank_v + (size_t)j*ts*gen_lowrank_k; \
+      for (int c = 0; c < ts; c++) { \
+         for (int r = 0; r < ts; r++) { \
+            T s = 0; \
+            for (int v = 0; v < gen_lowrank_k; v++) { \
+               s += (T)Vi[v*ts + r]*Vj[v*ts + c]; \
+            } \
+            A[c*ts + r] += gen_lowrank_down ? -s : s; \
+         } \
+      } \
+   } \
+}
+
+DEFINE_GEN_TILE(gen_tile, type_t, gen_value)
+DEFINE_GEN_TILE(gen_tile_d, double, gen_value_d)
+
+// Generates the whole matrix in column-major order with leading dimension ld
+void gen_matrix_linear(const int n, const uint64_t seed, const int ld, type_t *A)
+{
+   gen_tile_bs(n, seed, 0, 0, n, ld, A);
+}
+
+#pragma oss task out([ts*ts]A)
+void gen_block(const int n, const uint64_t seed, const int i, const int j, type_t *A)
+{
+   gen_tile(n, seed, i, j, A);
+}
+
+// Creates one generation task per tile, so each tile is available as soon as it is generated
+void gen_matrix_blocked(const int n, const int nt, const uint64_t seed, type_t *A)
+{
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         gen_block(n, seed, i, j, A + TILE_IDX(i, j)*ts*ts);
+      }
+   }
+}
+
+// Creates one generation task per allocated tile of a tile-sparse matrix, T
+// holds the tile pointers in the order of the blocked matrix, NULL if not allocated
+void gen_matrix_tiles(const int n, const int nt, const uint64_t seed, type_t * const *T)
+{
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         if (T[TILE_IDX(i, j)] != NULL) {
+            gen_block(n, seed, i, j, T[TILE_IDX(i, j)]);
+         }
+      }
+   }
+}
+
+// Generates the tile of a batch of n x n matrices, n < ts, that packs the
+// matrices first..first+ts/n-1 along its diagonal. Slots past the end of the
+// batch are filled with the identity so the tile stays SPD.
+#pragma oss task out([ts*ts]A)
+void gen_packed_block(const int n, const int nb, const uint64_t seed, const int first, type_t *A)
+{
+   memset(A, 0, ts*ts*sizeof(type_t));
+   for (int m = 0; m < ts/n; m++) {
+      type_t *Am = A + m*n*ts + m*n;
+      if (first + m < nb) {
+         gen_tile_bs(n, gen_jump(seed, (uint64_t)(first + m)*n*n), 0, 0, n, ts, Am);
+      } else {
+         for (int d = 0; d < n; d++) {
+            Am[d*ts + d] = 1;
+         }
+      }
+   }
+}
+
+// Generates a batch of nb independent n x n matrices, in the layout of
+// cholesky_batch. Matrix b continues the sequence of matrix b-1, so the first
+// one is the same matrix gen_matrix_blocked generates.
+void gen_batch(const int n, const int nb, const uint64_t seed, type_t *A)
+{
+   if (n < ts) {
+      const int pm = ts/n;
+      for (int t = 0; t < BATCH_TILES(n, nb); t++) {
+         gen_packed_block(n, nb, seed, t*pm, A + t*ts*ts);
+      }
+   } else {
+      const int nt = n/ts;
+      for (int b = 0; b < nb; b++) {
+         gen_matrix_blocked(n, nt, gen_jump(seed, (uint64_t)b*n*n), A + b*NUM_TILES(nt)*ts*ts);
+      }
+   }
+}
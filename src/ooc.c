@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cholesky.h"
+
+// Out-of-core tile store: the packed tiles of the blocked matrix are kept in a
+// file with the same layout as in memory, so every row run of tiles (i,j..j+c-1)
+// is read or written with a single pread/pwrite.
+
+static off_t tile_offset(const int i, const int j)
+{
+   return (off_t)TILE_IDX(i, j)*ts*ts*sizeof(type_t);
+}
+
+int ooc_open(ooc_store_t *st, const char *path, const int nt)
+{
+   st->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (st->fd < 0) {
+      perror("ERROR:\tCannot open the out-of-core file");
+      return -1;
+   }
+   if (ftruncate(st->fd, tile_offset(nt, 0)) != 0) {
+      perror("ERROR:\tCannot size the out-of-core file");
+      close(st->fd);
+      return -1;
+   }
+   ooc_reset_stats(st);
+   return 0;
+}
+
+void ooc_close(ooc_store_t *st)
+{
+   close(st->fd);
+   st->fd = -1;
+}
+
+void ooc_reset_stats(ooc_store_t *st)
+{
+   st->bytes_read = 0;
+   st->bytes_written = 0;
+   st->accesses = 0;
+   st->reads = 0;
+}
+
+// Reads the c tiles (i,j..j+c-1) to buf
+void ooc_read(ooc_store_t *st, const int i, const int j, const int c, type_t *buf)
+{
+   const size_t len = (size_t)c*ts*ts*sizeof(type_t);
+   for (size_t done = 0; done < len; ) {
+      const ssize_t r = pread(st->fd, (char *)buf + done, len - done, tile_offset(i, j) + done);
+      if (r <= 0) {
+         perror("ERROR:\tCannot read the out-of-core file");
+         exit(-1);
+      }
+      done += r;
+   }
+   __atomic_add_fetch(&st->bytes_read, len, __ATOMIC_RELAXED);
+   __atomic_add_fetch(&st->reads, c, __ATOMIC_RELAXED);
+}
+
+// Writes the c tiles (i,j..j+c-1) from buf
+void ooc_write(ooc_store_t *st, const int i, const int j, const int c, const type_t *buf)
+{
+   const size_t len = (size_t)c*ts*ts*sizeof(type_t);
+   for (size_t done = 0; done < len; ) {
+      const ssize_t r = pwrite(st->fd, (const char *)buf + done, len - done, tile_offset(i, j) + done);
+      if (r <= 0) {
+         perror("ERROR:\tCannot write the out-of-core file");
+         exit(-1);
+      }
+      done += r;
+   }
+   __atomic_add_fetch(&st->bytes_written, len, __ATOMIC_RELAXED);
+}
+
+#pragma oss task
+void ooc_gen_row(const int n, const uint64_t seed, const int i, ooc_store_t *st)
+{
+   type_t *row = (type_t *)malloc((size_t)(i + 1)*ts*ts*sizeof(type_t));
+   if (row == NULL) {
+      fprintf(stderr, "ERROR:\tCannot allocate a tile row of the out-of-core matrix\n");
+      exit(-1);
+   }
+   for (int j = 0; j <= i; j++) {
+      gen_tile(n, seed, i, j, row + j*ts*ts);
+   }
+   ooc_write(st, i, 0, i + 1, row);
+   free(row);
+}
+
+// Generates the same matrix as gen_matrix_blocked in the store, a tile row at a time
+void ooc_gen_matrix(const int n, const int nt, const uint64_t seed, ooc_store_t *st)
+{
+   for (int i = 0; i < nt; i++) {
+      ooc_gen_row(n, seed, i, st);
+   }
+   #pragma oss taskwait
+   ooc_reset_stats(st);
+}
@@ -0,0 +1,247 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <assert.h>
+
+#include "cholesky.h"
+
+// Mixed precision solve of A*X = B: A is factorized in type_t (float, to use
+// the float accelerators) and the solution is iteratively refined in double,
+// like LAPACK dsposv does. The double precision A is never stored, its tiles
+// are regenerated when computing the residuals.
+// Double right-hand sides and solutions are stored by row tiles of ts x nrhs
+// elements: element (r,c) at X[(r/ts)*ts*nrhs + c*ts + r%ts].
+
+// Computes R(i) = B(i) - A(i,:)*X and the row sums of |A(i,:)| in double
+#pragma oss task in([n*nrhs]X, [ts*nrhs]B) out([ts*nrhs]R, [ts]Asum)
+void refine_residual(const int n, const int nt, const uint64_t seed, const int i,
+   const int nrhs, const double *X, const double *B, double *R, double *Asum)
+{
+   double *Atile = (double *)malloc(ts*ts*sizeof(double));
+
+   memcpy(R, B, ts*nrhs*sizeof(double));
+   memset(Asum, 0, ts*sizeof(double));
+   for (int j = 0; j < nt; j++) {
+      // Only the lower tiles are generated, A(i,j) = A(j,i)' above the diagonal
+      gen_tile_d(n, seed, j > i ? j : i, j > i ? i : j, Atile);
+      cblas_dgemm(CBLAS_MAT_ORDER, j > i ? CBLAS_T : CBLAS_NT, CBLAS_NT,
+         ts, nrhs, ts, -1.0, Atile, ts, X + j*ts*nrhs, ts, 1.0, R, ts);
+      for (int c = 0; c < ts; c++) {
+         for (int r = 0; r < ts; r++) {
+            Asum[j > i ? c : r] += fabs(Atile[c*ts + r]);
+         }
+      }
+   }
+
+   free(Atile);
+}
+
+// Computes R = B - A*X, returns ||A||_oo
+static double residual(const int n, const int nt, const uint64_t seed,
+   const int nrhs, const double *B, const double *X, double *R, double *Asum)
+{
+   double Anorm = 0;
+
+   for (int i = 0; i < nt; i++) {
+      refine_residual(n, nt, seed, i, nrhs, X, B + i*ts*nrhs, R + i*ts*nrhs, Asum + i*ts);
+   }
+   #pragma oss taskwait
+
+   for (int r = 0; r < n; r++) {
+      Anorm = Asum[r] > Anorm ? Asum[r] : Anorm;
+   }
+
+   return Anorm;
+}
+
+// Converts the double row tiles D to the transposed type_t tiles T of cholesky_solve_blocked
+static void rows_to_rhs_tiles(const int nt, const int nq, const int nrhs, const double *D, type_t *T)
+{
+   for (int q = 0; q < nq; q++) {
+      for (int i = 0; i < nt; i++) {
+         type_t *Tqi = T + (q*nt + i)*ts*ts;
+         for (int r = 0; r < ts; r++) {
+            for (int c = 0; c < ts; c++) {
+               Tqi[r*ts + c] = q*ts + c < nrhs ? (type_t)D[i*ts*nrhs + (q*ts + c)*ts + r] : 0;
+            }
+         }
+      }
+   }
+}
+
+// Adds the transposed type_t tiles T of cholesky_solve_blocked to the double row tiles D
+static void rhs_tiles_add_rows(const int nt, const int nq, const int nrhs, const type_t *T, double *D)
+{
+   for (int q = 0; q < nq; q++) {
+      for (int i = 0; i < nt; i++) {
+         const type_t *Tqi = T + (q*nt + i)*ts*ts;
+         for (int r = 0; r < ts; r++) {
+            for (int c = 0; c < ts && q*ts + c < nrhs; c++) {
+               D[i*ts*nrhs + (q*ts + c)*ts + r] += Tqi[r*ts + c];
+            }
+         }
+      }
+   }
+}
+
+// Solves A*X = B with the type_t factor L of A and refines X in double.
+// Returns the number of refinement steps, or -1 if it did not converge.
+int cholesky_refine(const int n, const int nt, const uint64_t seed, const type_t *L,
+   const int nrhs, const double *B, double *X)
+{
+   const int nq = (nrhs + ts - 1)/ts;
+   const double eps = DBL_EPSILON/2;
+   type_t *T = (type_t *)malloc(nq*nt*ts*ts*sizeof(type_t));
+   double *R = (double *)malloc(n*nrhs*sizeof(double));
+   double *Asum = (double *)malloc(n*sizeof(double));
+   int iter, converged = 0;
+   assert(T != NULL && R != NULL && Asum != NULL);
+
+   // Initial solution in working precision
+   rows_to_rhs_tiles(nt, nq, nrhs, B, T);
+   cholesky_solve_blocked(nt, nq, L, T);
+   #pragma oss taskwait
+   memset(X, 0, n*nrhs*sizeof(double));
+   rhs_tiles_add_rows(nt, nq, nrhs, T, X);
+
+   for (iter = 0; iter <= REFINE_ITERMAX; iter++) {
+      const double Anorm = residual(n, nt, seed, nrhs, B, X, R, Asum);
+
+      // Same stopping criterion as dsposv, ||r||_oo < ||x||_oo*||A||_oo*eps*sqrt(n) for every column
+      converged = 1;
+      for (int c = 0; c < nrhs && converged; c++) {
+         double rnrm = 0, xnrm = 0;
+         for (int r = 0; r < n; r++) {
+            const int k = (r/ts)*ts*nrhs + c*ts + r%ts;
+            rnrm = fabs(R[k]) > rnrm ? fabs(R[k]) : rnrm;
+            xnrm = fabs(X[k]) > xnrm ? fabs(X[k]) : xnrm;
+         }
+         converged = rnrm < xnrm*Anorm*eps*sqrt(n);
+      }
+      if (converged || iter == REFINE_ITERMAX) break;
+
+      // X = X + inv(L*L')*R
+      rows_to_rhs_tiles(nt, nq, nrhs, R, T);
+      cholesky_solve_blocked(nt, nq, L, T);
+      #pragma oss taskwait
+      rhs_tiles_add_rows(nt, nq, nrhs, T, X);
+   }
+
+   free(Asum);
+   free(R);
+   free(T);
+
+   return converged ? iter : -1;
+}
+
+// Solves A*X = B with a full double precision factorization of A, used when
+// the refinement does not converge
+void cholesky_solve_d(const int n, const int nt, const uint64_t seed,
+   const int nrhs, const double *B, double *X)
+{
+   static const char L = 'L';
+   double *A = (double *)malloc((size_t)n*n*sizeof(double));
+   double *Xlin = (double *)malloc(n*nrhs*sizeof(double));
+   double *Atile = (double *)malloc(ts*ts*sizeof(double));
+   int info;
+   assert(A != NULL && Xlin != NULL && Atile != NULL);
+
+   for (int i = 0; i < nt; i++) {
+      for (int j = 0; j <= i; j++) {
+         gen_tile_d(n, seed, i, j, Atile);
+         for (int c = 0; c < ts; c++) {
+            memcpy(&A[(size_t)(j*ts + c)*n + i*ts], &Atile[c*ts], ts*sizeof(double));
+         }
+      }
+   }
+   for (int r = 0; r < n; r++) {
+      for (int c = 0; c < nrhs; c++) {
+         Xlin[c*n + r] = B[(r/ts)*ts*nrhs + c*ts + r%ts];
+      }
+   }
+
+   posv_d(&L, &n, &nrhs, A, &n, Xlin, &n, &info);
+   if (info != 0) {
+      fprintf(stderr, "WARNING:\tDouble precision factorization failed, info = %d\n", info);
+   }
+
+   for (int r = 0; r < n; r++) {
+      for (int c = 0; c < nrhs; c++) {
+         X[(r/ts)*ts*nrhs + c*ts + r%ts] = Xlin[c*n + r];
+      }
+   }
+
+   free(Atile);
+   free(Xlin);
+   free(A);
+}
+
+// Checks the double precision solution X of A*X = B through ||A*X-B||_oo/(||A||_oo.||X||_oo.N.eps)
+int check_refine(const int n, const int nt, const uint64_t seed,
+   const int nrhs, const double *B, const double *X)
+{
+   const double eps = DBL_EPSILON/2;
+   double *R = (double *)malloc(n*nrhs*sizeof(double));
+   double *Asum = (double *)malloc(n*sizeof(double));
+   assert(R != NULL && Asum != NULL);
+
+   const double Anorm = residual(n, nt, seed, nrhs, B, X, R, Asum);
+   double Rnorm = 0, Xnorm = 0;
+   for (int r = 0; r < n; r++) {
+      double rsum = 0, xsum = 0;
+      for (int c = 0; c < nrhs; c++) {
+         rsum += fabs(R[(r/ts)*ts*nrhs + c*ts + r%ts]);
+         xsum += fabs(X[(r/ts)*ts*nrhs + c*ts + r%ts]);
+      }
+      Rnorm = rsum > Rnorm ? rsum : Rnorm;
+      Xnorm = xsum > Xnorm ? xsum : Xnorm;
+   }
+
+   printf("==================================================\n");
+   printf("Checking the double precision solution of A*X = B\n");
+#ifdef VERBOSE
+   printf("-- ||A*X-B||_oo/(||A||_oo.||X||_oo.N.eps) = %e \n", Rnorm/(Anorm*Xnorm*n*eps));
+#endif
+
+   const int info_solve = isnan(Rnorm/(Anorm*Xnorm*n*eps)) ||
+      isinf(Rnorm/(Anorm*Xnorm*n*eps)) || (Rnorm/(Anorm*Xnorm*n*eps) > 60.0);
+
+   if ( info_solve ){
+      fprintf(stderr, "\n-- Solution is suspicious ! \n\n");
+   } else {
+      printf("\n-- Solution is CORRECT ! \n\n");
+   }
+
+   free(Asum);
+   free(R);
+
+   return info_solve;
+}
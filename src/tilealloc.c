@@ -0,0 +1,190 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "tilealloc.h"
+
+#define TA_CACHE_LINE 64
+#define TA_HUGE_PAGE  (2UL << 20)
+#define TA_MAX_NODES  256
+#define TA_LONG_BITS  (8*sizeof(unsigned long))
+
+//NOTE: The FPGA runtime DMA allocator can be plugged in with -DDMA_MALLOC=<f>
+//      and -DDMA_FREE=<f>, otherwise USE_DMA_MEM uses page-locked memory
+#if defined(USE_DMA_MEM) && defined(DMA_MALLOC) && defined(DMA_FREE)
+void *DMA_MALLOC(size_t size);
+void DMA_FREE(void *ptr);
+#  define TA_RUNTIME_DMA
+#endif
+
+static const char *names[TA_NUM] = {
+   "malloc", "aligned", "huge", "hugetlb", "interleave", "pinned"
+};
+
+int tile_alloc_kind(const char *name)
+{
+   for (int k = 0; k < TA_NUM; k++) {
+      if (strcmp(name, names[k]) == 0) return k;
+   }
+   return -1;
+}
+
+const char *tile_alloc_name(const int kind)
+{
+   return kind >= 0 && kind < TA_NUM ? names[kind] : "unknown";
+}
+
+static size_t round_up(const size_t size, const size_t align)
+{
+   return (size + align - 1)/align*align;
+}
+
+static void *align_alloc(const size_t align, const size_t size)
+{
+   void *ptr;
+   return posix_memalign(&ptr, align, round_up(size, align)) == 0 ? ptr : NULL;
+}
+
+static void *huge_alloc(const size_t size)
+{
+   void *ptr = align_alloc(TA_HUGE_PAGE, size);
+#ifdef MADV_HUGEPAGE
+   if (ptr != NULL) madvise(ptr, round_up(size, TA_HUGE_PAGE), MADV_HUGEPAGE);
+#endif
+   return ptr;
+}
+
+// Sets the online NUMA nodes in mask (e.g. "0-3,6") and returns the maxnode argument of mbind
+static unsigned long online_nodes(unsigned long *mask)
+{
+   int last = 0, first, end;
+   char c = ',';
+   memset(mask, 0, TA_MAX_NODES/8);
+   FILE *f = fopen("/sys/devices/system/node/online", "r");
+   if (f == NULL) {
+      mask[0] = 1;
+      return 2;
+   }
+   while (c == ',' && fscanf(f, "%d", &first) == 1) {
+      end = first;
+      if (fscanf(f, "%c", &c) == 1 && c == '-' && fscanf(f, "%d%c", &end, &c) < 1) break;
+      for (int i = first; i <= end && i < TA_MAX_NODES; i++) {
+         mask[i/TA_LONG_BITS] |= 1UL << (i%TA_LONG_BITS);
+         last = i;
+      }
+   }
+   fclose(f);
+   //NOTE: The kernel only reads the first maxnode - 1 bits
+   return last + 2;
+}
+
+// Allocates size bytes with the given kind. If it is not available, kind is
+// changed to the one actually used
+void *tile_alloc(int *kind, const size_t size)
+{
+   void *ptr = NULL;
+   size_t align = TA_CACHE_LINE;
+#ifdef FPGA_MEMORY_PORT_WIDTH
+   if (FPGA_MEMORY_PORT_WIDTH/8 > align) align = FPGA_MEMORY_PORT_WIDTH/8;
+#endif
+
+   switch (*kind) {
+      case TA_MALLOC:
+         ptr = malloc(size);
+         break;
+      case TA_ALIGNED:
+         ptr = align_alloc(align, size);
+         break;
+      case TA_HUGE:
+         ptr = huge_alloc(size);
+         break;
+      case TA_HUGETLB:
+#ifdef MAP_HUGETLB
+         ptr = mmap(NULL, round_up(size, TA_HUGE_PAGE), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+         if (ptr != MAP_FAILED) break;
+#endif
+         fprintf(stderr, "WARNING:\tNo huge pages reserved for the matrix, using transparent huge pages\n");
+         *kind = TA_HUGE;
+         ptr = huge_alloc(size);
+         break;
+      case TA_INTERLEAVE:
+         ptr = huge_alloc(size);
+         if (ptr != NULL) {
+            //NOTE: Bits above the nodes supported by the kernel are rejected, so only online ones are set
+            unsigned long nodes[TA_MAX_NODES/TA_LONG_BITS];
+            const unsigned long maxnode = online_nodes(nodes);
+            if (syscall(SYS_mbind, ptr, round_up(size, TA_HUGE_PAGE), MPOL_INTERLEAVE,
+                  nodes, maxnode, 0) != 0) {
+               fprintf(stderr, "WARNING:\tCannot interleave the matrix pages, using the default policy\n");
+               *kind = TA_HUGE;
+            }
+         }
+         break;
+      case TA_PINNED:
+#ifdef TA_RUNTIME_DMA
+         ptr = DMA_MALLOC(size);
+#else
+         ptr = mmap(NULL, round_up(size, sysconf(_SC_PAGESIZE)), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_LOCKED, -1, 0);
+         if (ptr == MAP_FAILED) {
+            fprintf(stderr, "WARNING:\tCannot lock the matrix pages (see 'ulimit -l'), using aligned memory\n");
+            *kind = TA_ALIGNED;
+            ptr = align_alloc(align, size);
+         }
+#endif
+         break;
+   }
+   return ptr;
+}
+
+void tile_free(const int kind, void *ptr, const size_t size)
+{
+   if (ptr == NULL) return;
+   switch (kind) {
+      case TA_HUGETLB:
+         munmap(ptr, round_up(size, TA_HUGE_PAGE));
+         break;
+      case TA_PINNED:
+#ifdef TA_RUNTIME_DMA
+         DMA_FREE(ptr);
+#else
+         munmap(ptr, round_up(size, sysconf(_SC_PAGESIZE)));
+#endif
+         break;
+      default:
+         free(ptr);
+   }
+}
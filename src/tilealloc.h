@@ -0,0 +1,52 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __TILEALLOC_H__
+#define __TILEALLOC_H__
+
+#include <stddef.h>
+
+// Allocators of the blocked matrix, selected at run time by name. Unless the
+// pages are locked, they are first touched by the tasks that generate each
+// tile, so they are placed next to the cores that own them.
+
+enum {
+   TA_MALLOC,     // plain malloc
+   TA_ALIGNED,    // aligned to the cache line and the FPGA memory port
+   TA_HUGE,       // 2 MB aligned, with transparent huge pages
+   TA_HUGETLB,    // explicit huge pages (hugetlbfs), falls back to TA_HUGE
+   TA_INTERLEAVE, // like TA_HUGE, with the pages interleaved over the NUMA nodes
+   TA_PINNED,     // DMA memory of the FPGA runtime, or page-locked memory
+   TA_NUM
+};
+
+int tile_alloc_kind(const char *name);
+const char *tile_alloc_name(const int kind);
+void *tile_alloc(int *kind, const size_t size);
+void tile_free(const int kind, void *ptr, const size_t size);
+
+#endif //__TILEALLOC_H__
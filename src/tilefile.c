@@ -0,0 +1,124 @@
+/*
+* Copyright (c) 2020, BSC (Barcelona Supercomputing Center)
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright
+*       notice, this list of conditions and the following disclaimer in the
+*       documentation and/or other materials provided with the distribution.
+*     * Neither the name of the <organization> nor the
+*       names of its contributors may be used to endorse or promote products
+*       derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY BSC ''AS IS'' AND ANY
+* EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL <copyright holder> BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cholesky.h"
+
+// Binary tiled matrix files: a tilefile_header_t followed, at data_offset, by
+// the tiles in the order of the blocked matrix, so the data can be mapped as
+// it is. See README for the format.
+
+#define TILEFILE_ALIGN 4096 // data offset of the created files, a multiple of the page size
+
+static size_t tilefile_tiles(const tilefile_header_t *hdr)
+{
+   const size_t nt = hdr->n/hdr->ts;
+   return hdr->flags & TILEFILE_LOWER ? NUM_TILES(nt) : nt*nt;
+}
+
+static size_t tilefile_len(const tilefile_header_t *hdr)
+{
+   return hdr->data_offset + tilefile_tiles(hdr)*hdr->ts*hdr->ts*hdr->elem_size;
+}
+
+// Maps the tiles of file path, read-only or copy-on-write, and reads its header
+type_t *tilefile_map(const char *path, const int writable, tilefile_header_t *hdr)
+{
+   const int fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      perror("ERROR:\tCannot open the matrix file");
+      return NULL;
+   }
+   struct stat sb;
+   if (read(fd, hdr, sizeof(*hdr)) != sizeof(*hdr) || memcmp(hdr->magic, TILEFILE_MAGIC, 8) != 0 ||
+      hdr->version != TILEFILE_VERSION || hdr->ts == 0 || hdr->n % hdr->ts != 0 ||
+      hdr->data_offset % TILEFILE_ALIGN != 0 || fstat(fd, &sb) != 0 || (size_t)sb.st_size < tilefile_len(hdr)) {
+      fprintf(stderr, "ERROR:\t'%s' is not a valid matrix file\n", path);
+      close(fd);
+      return NULL;
+   }
+   char *base = mmap(NULL, tilefile_len(hdr), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+      writable ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+   close(fd);
+   if (base == MAP_FAILED) {
+      perror("ERROR:\tCannot map the matrix file");
+      return NULL;
+   }
+   return (type_t *)(base + hdr->data_offset);
+}
+
+// Creates file path for the lower tiles of an n x n matrix and maps them shared,
+// so everything written to them ends up in the file
+type_t *tilefile_create(const char *path, const int n, const uint32_t flags, const uint64_t seed,
+   tilefile_header_t *hdr)
+{
+   memset(hdr, 0, sizeof(*hdr));
+   memcpy(hdr->magic, TILEFILE_MAGIC, 8);
+   hdr->version = TILEFILE_VERSION;
+   hdr->elem_size = sizeof(type_t);
+   hdr->n = n;
+   hdr->ts = ts;
+   hdr->flags = flags | TILEFILE_LOWER;
+   hdr->seed = seed;
+   hdr->data_offset = TILEFILE_ALIGN;
+
+   const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) {
+      perror("ERROR:\tCannot create the matrix file");
+      return NULL;
+   }
+   if (ftruncate(fd, tilefile_len(hdr)) != 0 || pwrite(fd, hdr, sizeof(*hdr), 0) != sizeof(*hdr)) {
+      perror("ERROR:\tCannot write the matrix file");
+      close(fd);
+      return NULL;
+   }
+   char *base = mmap(NULL, tilefile_len(hdr), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (base == MAP_FAILED) {
+      perror("ERROR:\tCannot map the matrix file");
+      return NULL;
+   }
+   return (type_t *)(base + hdr->data_offset);
+}
+
+// Unmaps the tiles mapped by tilefile_map or tilefile_create, writing them
+// back to the file first if it is shared and writable
+void tilefile_unmap(const tilefile_header_t *hdr, type_t *A, const int sync)
+{
+   char *base = (char *)A - hdr->data_offset;
+   if (sync && msync(base, tilefile_len(hdr), MS_SYNC) != 0) {
+      perror("WARNING:\tCannot write back the matrix file");
+   }
+   munmap(base, tilefile_len(hdr));
+}